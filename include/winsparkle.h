@@ -217,7 +217,11 @@ WIN_SPARKLE_API int __cdecl win_sparkle_set_dsa_pub_pem(const char *dsa_pub_pem)
     It will be set only if it contains a valid EdDSA public key.
 
     If this function isn't called by the app, public key is obtained from
-    Windows resource named "EdDSAPub" of type "EDDSA".
+    Windows resource named "EdDSAPub" of type "EDDSA". The resource may
+    contain several whitespace-separated keys, all of which are trusted.
+
+    This function replaces any previously set keys, as well as those from
+    the resource.
 
     @note
     If this function is called, DSA public key set with win_sparkle_set_dsa_pub_pem()
@@ -228,9 +232,35 @@ WIN_SPARKLE_API int __cdecl win_sparkle_set_dsa_pub_pem(const char *dsa_pub_pem)
     @return  1 if a valid EdDSA public key is provided, 0 otherwise.
 
     @since 0.9.0
+
+    @see win_sparkle_add_eddsa_public_key()
  */
 WIN_SPARKLE_API int __cdecl win_sparkle_set_eddsa_public_key(const char *pubkey);
 
+/**
+    Adds another trusted EdDSA public key.
+
+    Update files signed with any of the trusted keys are accepted. This is
+    useful for rotating keys: ship the new key alongside the old one, then
+    start signing updates with the new key.
+
+    If the appcast specifies the key with the sparkle:edKeyId attribute, only
+    that key is used to verify the signature.
+
+    Like win_sparkle_set_eddsa_public_key(), calling this function replaces
+    keys from the "EdDSAPub" resource, so all keys must be added using the API.
+
+    @param pubkey  EdDSA public key in base64 encoded format.
+
+    @return  1 if a valid EdDSA public key is provided, 0 otherwise or if
+             called after win_sparkle_init().
+
+    @since 0.10
+
+    @see win_sparkle_set_eddsa_public_key()
+ */
+WIN_SPARKLE_API int __cdecl win_sparkle_add_eddsa_public_key(const char *pubkey);
+
 /**
     Sets application metadata.
 
@@ -294,6 +324,44 @@ WIN_SPARKLE_API void __cdecl win_sparkle_set_http_header(const char *name, const
 */
 WIN_SPARKLE_API void __cdecl win_sparkle_clear_http_headers();
 
+/**
+    Sets timeouts for appcast checks and update downloads.
+
+    All values are in seconds. Pass 0 to disable the respective timeout.
+
+    @param connect_timeout     Time allowed for connecting to the server. If 0,
+                               the system default is used.
+    @param first_byte_timeout  Time allowed from sending the request until
+                               the server's response arrives. Default: 60.
+    @param inactivity_timeout  Time allowed without receiving any data while
+                               downloading. Default: 30.
+
+    @since 0.10
+
+    @see win_sparkle_set_download_min_speed()
+*/
+WIN_SPARKLE_API void __cdecl win_sparkle_set_download_timeouts(int connect_timeout,
+                                                               int first_byte_timeout,
+                                                               int inactivity_timeout);
+
+/**
+    Sets minimal acceptable download speed.
+
+    If less than @a min_bytes_per_sec bytes per second on average are
+    received during a period of @a period seconds, the transfer is aborted.
+    Update downloads are then resumed, from another mirror if there is one.
+
+    By default, there's no minimal speed.
+
+    @param min_bytes_per_sec  Minimal speed; 0 disables the check.
+    @param period             Length of the period the speed is measured over.
+
+    @since 0.10
+
+    @see win_sparkle_set_download_timeouts()
+*/
+WIN_SPARKLE_API void __cdecl win_sparkle_set_download_min_speed(int min_bytes_per_sec, int period);
+
 /**
     Sets the registry path where settings will be stored.
 
@@ -349,6 +417,28 @@ typedef struct win_sparkle_config_methods_tag {
 */
 WIN_SPARKLE_API void __cdecl win_sparkle_set_config_methods(win_sparkle_config_methods_t *config_methods);
 
+/**
+    Enables or disables caching of the appcast on disk.
+
+    To avoid downloading and parsing unchanged or append-only feeds again,
+    WinSparkle keeps the parsed appcast in a cache in the user's local
+    application data folder (under "vendor\app\WinSparkle", with the names
+    taken from the application's resources or set with
+    win_sparkle_set_app_details()). The cache is enabled by default, unless
+    custom configuration methods were set with
+    win_sparkle_set_config_methods(), because then the application manages
+    WinSparkle's storage itself.
+
+    This function must be called before win_sparkle_init().
+
+    @param  enabled  1 to cache appcast data, 0 to never write them to disk.
+
+    @since 0.10
+
+    @see win_sparkle_set_config_methods()
+ */
+WIN_SPARKLE_API void __cdecl win_sparkle_set_appcast_cache(int enabled);
+
 /**
     Sets whether updates are checked automatically or only through a manual call.
 
@@ -390,6 +480,28 @@ WIN_SPARKLE_API void __cdecl win_sparkle_set_update_check_interval(int interval)
  */
 WIN_SPARKLE_API int __cdecl win_sparkle_get_update_check_interval();
 
+/**
+    Enables adaptive automatic update interval.
+
+    When enabled, WinSparkle observes how often the appcast changes and checks
+    less frequently while it doesn't: the interval doubles after every check
+    that finds the feed unchanged, up to @a max_interval. As soon as the feed
+    changes or offers a critical update, it returns to the interval set with
+    win_sparkle_set_update_check_interval(), which serves as the minimum.
+    Manual checks don't affect the interval.
+
+    This function must be called before win_sparkle_init().
+
+    @param  max_interval  The longest interval in seconds between checks
+                          for updates, or 0 to disable adaptive checking
+                          (the default).
+
+    @since 0.10
+
+    @see win_sparkle_set_update_check_interval()
+ */
+WIN_SPARKLE_API void __cdecl win_sparkle_set_adaptive_update_check(int max_interval);
+
 /**
     Gets the time of the last update check.
 
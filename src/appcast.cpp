@@ -24,7 +24,9 @@
  */
 
 #include "appcast.h"
+#include "decompress.h"
 #include "error.h"
+#include "threads.h"
 
 #include <expat.h>
 #include <algorithm>
@@ -54,7 +56,7 @@ namespace
 
 // Misc helper functions:
 
-bool is_compatible_with_windows_version(Appcast item)
+bool is_compatible_with_windows_version(const Appcast& item)
 {
     auto& version = item.MinOSVersion;
 
@@ -119,40 +121,120 @@ inline bool is_compatible_with_os_arch(const Appcast::Enclosure& enclosure)
 }
 
 
-// Finds the best enclosure for the current OS and architecture.
-Appcast::Enclosure find_best_enclosure_for_os_arch(const std::vector<Appcast::Enclosure>& enclosures)
+// Checks if the enclosure can be used, i.e. is compatible with the running OS
+// and we know how to decompress it, if it is compressed.
+inline bool is_usable_enclosure(const Appcast::Enclosure& enclosure)
 {
-	// filter out incompatible enclosures:
-	std::vector<Appcast::Enclosure> compatible;
-	std::copy_if(enclosures.begin(), enclosures.end(), std::back_inserter(compatible), is_compatible_with_os_arch);
-    if (compatible.empty())
-		return Appcast::Enclosure();
+    if (!enclosure.Compression.empty() && !DecompressingDownloadSink::IsSupported(enclosure.Compression))
+        return false;
+    return is_compatible_with_os_arch(enclosure);
+}
+
+
+// Finds the best enclosure for the current OS and architecture. Returns NULL
+// if none of the enclosures is usable.
+Appcast::Enclosure *find_best_enclosure_for_os_arch(std::vector<Appcast::Enclosure>& enclosures)
+{
+    Appcast::Enclosure *generic = NULL;
+    Appcast::Enclosure *any = NULL;
+
+    for (auto& e : enclosures)
+    {
+        if (!is_usable_enclosure(e))
+            continue;
+
+        // arch-specific enclosure is the best match
+        if (e.OS == OS_MARKER_ARCH)
+            return &e;
+
+        // otherwise prefer one explicitly marked as for windows, then
+        // any of the compatible ones, e.g. the first one
+        if (!generic && e.OS == OS_MARKER_GENERIC)
+            generic = &e;
+        if (!any)
+            any = &e;
+    }
+
+    return generic ? generic : any;
+}
+
+
+// Checks if two enclosures are the same file at different URLs.
+bool is_mirror_of(const Appcast::Enclosure& a, const Appcast::Enclosure& b)
+{
+    if (a.OS != b.OS ||
+        a.Compression != b.Compression ||
+        a.SignatureOfCompressedData != b.SignatureOfCompressedData ||
+        a.InstallerArguments != b.InstallerArguments ||
+        a.Sha256 != b.Sha256 ||
+        a.EdKeyId != b.EdKeyId)
+        return false;
+
+    // only the signature identifies the file reliably:
+    if (!a.EdDsaTreeSignature.empty())
+        return a.EdDsaTreeSignature == b.EdDsaTreeSignature;
+    if (!a.EdDsaSignature.empty())
+        return a.EdDsaSignature == b.EdDsaSignature;
+    if (!a.DsaSignature.empty())
+        return a.DsaSignature == b.DsaSignature;
+    return false;
+}
 
-	// is there arch-specific enclosure?
-	auto it = std::find_if(compatible.begin(), compatible.end(),
-                           [](const Appcast::Enclosure& e) { return e.OS == OS_MARKER_ARCH; });
-	if (it != compatible.end())
-		return *it;
 
-    // is there an enclosure explicitly marked as for windows?
-    it = std::find_if(compatible.begin(), compatible.end(),
-                      [](const Appcast::Enclosure& e) { return e.OS == OS_MARKER_GENERIC; });
-    if (it != compatible.end())
-        return *it;
+// Merges enclosures with the same signature into one, with the others'
+// URLs as mirrors.
+void merge_mirror_enclosures(std::vector<Appcast::Enclosure>& enclosures)
+{
+    if (enclosures.size() < 2)
+        return;
 
-    // because all enclosures are compatible, any one will do, e.g. the first one:
-	return compatible.front();
+    std::vector<Appcast::Enclosure> merged;
+    merged.reserve(enclosures.size());
+    for (auto& e : enclosures)
+    {
+        auto it = std::find_if(merged.begin(), merged.end(),
+                               [&e](const Appcast::Enclosure& m) { return is_mirror_of(m, e); });
+        if (it == merged.end())
+        {
+            merged.push_back(std::move(e));
+        }
+        else
+        {
+            it->MirrorURLs.push_back(std::move(e.DownloadURL));
+            std::move(e.MirrorURLs.begin(), e.MirrorURLs.end(), std::back_inserter(it->MirrorURLs));
+        }
+    }
+    enclosures.swap(merged);
 }
 
 
+// Trims whitespace in place; call once the element's text is complete.
 void trim_whitespace(std::string& s)
 {
-    size_t startpos = s.find_first_not_of(" \t\r\n");
-    if (startpos != std::string::npos)
-        s = s.substr(startpos);
-    size_t endpos = s.find_last_not_of(" \t\r\n");
-    if (endpos != std::string::npos)
-        s = s.substr(0, endpos + 1);
+    const size_t endpos = s.find_last_not_of(" \t\r\n");
+    s.erase(endpos == std::string::npos ? 0 : endpos + 1);
+    s.erase(0, s.find_first_not_of(" \t\r\n"));
+}
+
+
+// Parses file size in decimal. Returns false if it isn't a number or
+// doesn't fit into 64 bits.
+bool parse_length(const char *s, uint64_t& value)
+{
+    if ( !*s )
+        return false;
+
+    value = 0;
+    for ( ; *s; s++ )
+    {
+        if ( *s < '0' || *s > '9' )
+            return false;
+        const unsigned digit = unsigned(*s - '0');
+        if ( value > (UINT64_MAX - digit) / 10 )
+            return false;
+        value = value * 10 + digit;
+    }
+    return true;
 }
 
 
@@ -160,41 +242,127 @@ void trim_whitespace(std::string& s)
                                 XML parsing
  *--------------------------------------------------------------------------*/
 
-#define MVAL(x) x
-#define CONCAT3(a,b,c) MVAL(a)##MVAL(b)##MVAL(c)
-
 #define NS_SPARKLE      "http://www.andymatuschak.org/xml-namespaces/sparkle"
 #define NS_SEP          '#'
-#define NS_SPARKLE_NAME(name) NS_SPARKLE "#" name
-
-#define NODE_CHANNEL    "channel"
-#define NODE_ITEM       "item"
-#define NODE_RELNOTES   NS_SPARKLE_NAME("releaseNotesLink")
-#define NODE_TITLE "title"
-#define NODE_DESCRIPTION "description"
-#define NODE_LINK       "link"
-#define NODE_ENCLOSURE  "enclosure"
-#define NODE_MIN_OS_VERSION NS_SPARKLE_NAME("minimumSystemVersion")
-#define NODE_CRITICAL_UPDATE NS_SPARKLE_NAME("criticalUpdate")
-#define ATTR_URL        "url"
-#define ATTR_VERSION    NS_SPARKLE_NAME("version")
-#define ATTR_SHORTVERSION NS_SPARKLE_NAME("shortVersionString")
-#define ATTR_DSASIGNATURE NS_SPARKLE_NAME("dsaSignature")
-#define ATTR_EDDSASIGNATURE NS_SPARKLE_NAME("edSignature")
-#define ATTR_OS         NS_SPARKLE_NAME("os")
-#define ATTR_ARGUMENTS  NS_SPARKLE_NAME("installerArguments")
-#define NODE_VERSION      ATTR_VERSION        // These can be nodes or
-#define NODE_SHORTVERSION ATTR_SHORTVERSION   // attributes.
-#define NODE_DSASIGNATURE ATTR_DSASIGNATURE
+
+// Element and attribute names the parser is interested in. Some of them
+// (e.g. version) can be both elements and attributes.
+enum XmlName
+{
+    NAME_UNKNOWN,
+
+    NAME_CHANNEL,
+    NAME_ITEM,
+    NAME_TITLE,
+    NAME_DESCRIPTION,
+    NAME_LINK,
+    NAME_ENCLOSURE,
+    NAME_URL,
+    NAME_LENGTH,
+
+    NAME_RELNOTES,
+    NAME_MIRROR,
+    NAME_MIN_OS_VERSION,
+    NAME_CRITICAL_UPDATE,
+    NAME_NOTIFICATIONS,
+    NAME_APPEND_ONLY,
+    NAME_VERSION,
+    NAME_SHORTVERSION,
+    NAME_DSASIGNATURE,
+    NAME_EDDSASIGNATURE,
+    NAME_EDDSATREESIGNATURE,
+    NAME_EDKEYID,
+    NAME_OS,
+    NAME_ARGUMENTS,
+    NAME_COMPRESSION,
+    NAME_SIGNEDDATA,
+    NAME_DECOMPRESSED_LENGTH,
+    NAME_SHA256,
+    NAME_CHUNK_MANIFEST,
+    NAME_CHUNK_MANIFEST_SIGNATURE
+};
+
+struct XmlNameEntry
+{
+    const char *local;
+    XmlName name;
+};
+
+// names without a namespace
+const XmlNameEntry NAMES_NO_NS[] =
+{
+    { "channel",     NAME_CHANNEL },
+    { "item",        NAME_ITEM },
+    { "title",       NAME_TITLE },
+    { "description", NAME_DESCRIPTION },
+    { "link",        NAME_LINK },
+    { "enclosure",   NAME_ENCLOSURE },
+    { "url",         NAME_URL },
+    { "length",      NAME_LENGTH }
+};
+
+// names in the Sparkle namespace
+const XmlNameEntry NAMES_SPARKLE[] =
+{
+    { "releaseNotesLink",     NAME_RELNOTES },
+    { "mirror",               NAME_MIRROR },
+    { "minimumSystemVersion", NAME_MIN_OS_VERSION },
+    { "criticalUpdate",       NAME_CRITICAL_UPDATE },
+    { "notifications",        NAME_NOTIFICATIONS },
+    { "appendOnly",           NAME_APPEND_ONLY },
+    { "version",              NAME_VERSION },
+    { "shortVersionString",   NAME_SHORTVERSION },
+    { "dsaSignature",         NAME_DSASIGNATURE },
+    { "edSignature",          NAME_EDDSASIGNATURE },
+    { "edSignatureTree",      NAME_EDDSATREESIGNATURE },
+    { "edKeyId",              NAME_EDKEYID },
+    { "os",                   NAME_OS },
+    { "installerArguments",   NAME_ARGUMENTS },
+    { "compression",          NAME_COMPRESSION },
+    { "decompressedLength",   NAME_DECOMPRESSED_LENGTH },
+    { "signedData",           NAME_SIGNEDDATA },
+    { "sha256",               NAME_SHA256 },
+    { "chunkManifest",        NAME_CHUNK_MANIFEST },
+    { "chunkManifestEdSignature", NAME_CHUNK_MANIFEST_SIGNATURE }
+};
+
+template<size_t N>
+XmlName find_local_name(const XmlNameEntry (&table)[N], const char *local)
+{
+    for (size_t i = 0; i < N; i++)
+    {
+        if (strcmp(table[i].local, local) == 0)
+            return table[i].name;
+    }
+    return NAME_UNKNOWN;
+}
+
+// Maps a name as reported by expat ("namespace#local" or just "local") to
+// XmlName. The namespace is compared only once, unlike when comparing full
+// names against each of the candidates.
+XmlName lookup_name(const char *name)
+{
+    const char *sep = strrchr(name, NS_SEP);
+    if (!sep)
+        return find_local_name(NAMES_NO_NS, name);
+
+    const size_t nsLength = sep - name;
+    if (nsLength == sizeof(NS_SPARKLE) - 1 && memcmp(name, NS_SPARKLE, nsLength) == 0)
+        return find_local_name(NAMES_SPARKLE, sep + 1);
+
+    return NAME_UNKNOWN;
+}
 
 
 // context data for the parser
 struct ContextData
 {
-    ContextData(XML_Parser& p)
-        : parser(p),
+    ContextData(XML_Parser& p, const std::shared_ptr<const std::string>& xml)
+        : parser(p), source(xml), prolog_length(0), lazy_text(true),
+        header_length(0), data_begin(0), text_begin(0),
         in_channel(0), in_item(0), in_relnotes(0), in_title(0), in_description(0), in_link(0),
-        in_version(0), in_shortversion(0), in_dsasignature(0), in_min_os_version(0)
+        in_version(0), in_shortversion(0), in_dsasignature(0), in_min_os_version(0),
+        in_enclosure(0), enclosure_added(false)
     {}
 
 	// call when entering <item> element
@@ -208,12 +376,36 @@ struct ContextData
     // the parser we're using
     XML_Parser& parser;
 
+    // parsed data, referred to by lazily decoded texts
+    std::shared_ptr<const std::string> source;
+    size_t prolog_length;
+    bool lazy_text;
+
+    // when parsing only a part of the source, it is preceded by a header of
+    // this length that isn't part of the source, see parse_feed()
+    size_t header_length;
+    size_t data_begin;
+
+    // converts parser's byte index to offset in the source
+    size_t source_offset(XML_Index index) const
+    {
+        const size_t pos = size_t(index);
+        return pos < header_length ? pos : pos - header_length + data_begin;
+    }
+
+    // start of <title> or <description> content
+    size_t text_begin;
+
     // is inside <channel>, <item> or <sparkle:releaseNotesLink>, <title>, <description>, or <link> respectively?
     int in_channel, in_item, in_relnotes, in_title, in_description, in_link;
 
     // is inside <sparkle:version> or <sparkle:shortVersionString> etc. node?
     int in_version, in_shortversion, in_dsasignature, in_min_os_version;
 
+    // is inside <enclosure> and was it added to enclosures?
+    int in_enclosure;
+    bool enclosure_added;
+
     // currently parsed item
     Appcast current;
 
@@ -225,92 +417,226 @@ struct ContextData
     
     // parsed <item>s
     std::vector<Appcast> all_items;
+
+    // channel-level information
+    AppcastChannel channel;
 };
 
 
+// Returns offset of the current tag.
+size_t current_offset(ContextData& ctxt)
+{
+    return ctxt.source_offset(XML_GetCurrentByteIndex(ctxt.parser));
+}
+
+// Returns offset of the content following the current tag.
+size_t current_content_offset(ContextData& ctxt)
+{
+    return ctxt.source_offset(XML_GetCurrentByteIndex(ctxt.parser) +
+                              XML_GetCurrentByteCount(ctxt.parser));
+}
+
+
+// Makes the text refer to the content of the element that is just ending.
+void set_text_source(ContextData& ctxt, AppcastText& text)
+{
+    if (!ctxt.lazy_text)
+        return;
+
+    // empty elements (<description/>) end where they start
+    const size_t end = current_offset(ctxt);
+    text.SetSource(ctxt.source, ctxt.prolog_length, ctxt.text_begin,
+                   (std::max)(end, ctxt.text_begin));
+}
+
+
+void XMLCALL OnXmlDecl(void *data, const char *, const char *, int)
+{
+    ContextData& ctxt = *static_cast<ContextData*>(data);
+    ctxt.prolog_length = current_content_offset(ctxt);
+}
+
+
+// Collects all text of a XML fragment, see AppcastText::Get().
+void XMLCALL OnFragmentText(void *data, const char *s, int len)
+{
+    static_cast<std::string*>(data)->append(s, len);
+}
+
+
 void XMLCALL OnStartElement(void *data, const char *name, const char **attrs)
 {
     ContextData& ctxt = *static_cast<ContextData*>(data);
+    const XmlName tag = lookup_name(name);
 
-    if ( strcmp(name, NODE_CHANNEL) == 0 )
+    if ( tag == NAME_CHANNEL )
     {
         ctxt.in_channel++;
     }
-    else if ( ctxt.in_channel && strcmp(name, NODE_ITEM) == 0 )
+    else if ( ctxt.in_channel && tag == NAME_ITEM )
     {
         ctxt.in_item++;
         ctxt.reset_for_new_item();
+
+        ctxt.current.SourceBegin = current_offset(ctxt);
+        if ( !ctxt.channel.ItemsEnd )
+            ctxt.channel.ItemsBegin = ctxt.current.SourceBegin;
     }
     else if ( ctxt.in_item )
     {
-        if ( strcmp(name, NODE_RELNOTES) == 0 )
-        {
-            ctxt.in_relnotes++;
-        }
-        else if ( strcmp(name, NODE_TITLE) == 0 )
-        {
-            ctxt.in_title++;
-        }
-        else if ( strcmp(name, NODE_DESCRIPTION) == 0 )
-        {
-            ctxt.in_description++;
-        }
-        else if ( strcmp(name, NODE_LINK) == 0 )
-        {
-            ctxt.in_link++;
-        }
-        else if ( strcmp(name, NODE_VERSION) == 0 )
-        {
-            ctxt.in_version++;
-        }
-        else if ( strcmp(name, NODE_SHORTVERSION) == 0 )
-        {
-            ctxt.in_shortversion++;
-        }
-        else if (strcmp(name, NODE_DSASIGNATURE) == 0)
-        {
-            ctxt.in_dsasignature++;
-        }
-        else if (strcmp(name, NODE_MIN_OS_VERSION) == 0)
+        switch ( tag )
         {
-            ctxt.in_min_os_version++;
-        }
-        else if (strcmp(name, NODE_ENCLOSURE) == 0)
-        {
-            Appcast& item = ctxt.current;
-			Appcast::Enclosure enclosure;
-
-            for (int i = 0; attrs[i]; i += 2)
+            case NAME_RELNOTES:
+                ctxt.in_relnotes++;
+                break;
+
+            case NAME_TITLE:
+                if ( ctxt.in_title++ == 0 )
+                    ctxt.text_begin = current_content_offset(ctxt);
+                break;
+
+            case NAME_DESCRIPTION:
+                if ( ctxt.in_description++ == 0 )
+                    ctxt.text_begin = current_content_offset(ctxt);
+                break;
+
+            case NAME_LINK:
+                ctxt.in_link++;
+                break;
+
+            case NAME_VERSION:
+                ctxt.in_version++;
+                break;
+
+            case NAME_SHORTVERSION:
+                ctxt.in_shortversion++;
+                break;
+
+            case NAME_DSASIGNATURE:
+                if ( ctxt.in_dsasignature++ == 0 )
+                    ctxt.legacy_dsa_signature.clear();
+                break;
+
+            case NAME_MIN_OS_VERSION:
+                ctxt.in_min_os_version++;
+                break;
+
+            case NAME_ENCLOSURE:
             {
-                const char* name = attrs[i];
-                const char* value = attrs[i + 1];
-
-                if (strcmp(name, ATTR_URL) == 0)
-                    enclosure.DownloadURL = value;
-                else if (strcmp(name, ATTR_EDDSASIGNATURE) == 0)
-                    enclosure.EdDsaSignature = value;
-                else if (strcmp(name, ATTR_DSASIGNATURE) == 0)
-                    enclosure.DsaSignature = value;
-                else if (strcmp(name, ATTR_OS) == 0)
-                    enclosure.OS = value;
-                else if (strcmp(name, ATTR_ARGUMENTS) == 0)
-                    enclosure.InstallerArguments = value;
-
-                // legacy syntax where version info was on enclosure, not item:
-                else if (strcmp(name, ATTR_VERSION) == 0)
-                    item.Version = value;
-                else if (strcmp(name, ATTR_SHORTVERSION) == 0)
-                    item.ShortVersionString = value;
+                Appcast& item = ctxt.current;
+                Appcast::Enclosure enclosure;
+                bool malformed = false;
+
+                for ( int i = 0; attrs[i]; i += 2 )
+                {
+                    const char* value = attrs[i + 1];
+
+                    switch ( lookup_name(attrs[i]) )
+                    {
+                        case NAME_URL:
+                            enclosure.DownloadURL = value;
+                            break;
+                        case NAME_EDDSASIGNATURE:
+                            enclosure.EdDsaSignature = value;
+                            break;
+                        case NAME_EDDSATREESIGNATURE:
+                            enclosure.EdDsaTreeSignature = value;
+                            break;
+                        case NAME_EDKEYID:
+                            enclosure.EdKeyId = value;
+                            break;
+                        case NAME_DSASIGNATURE:
+                            enclosure.DsaSignature = value;
+                            break;
+                        case NAME_OS:
+                            enclosure.OS = value;
+                            break;
+                        case NAME_ARGUMENTS:
+                            enclosure.InstallerArguments = value;
+                            break;
+                        case NAME_COMPRESSION:
+                            enclosure.Compression = value;
+                            break;
+                        case NAME_SIGNEDDATA:
+                            enclosure.SignatureOfCompressedData = (strcmp(value, "compressed") == 0);
+                            break;
+                        case NAME_LENGTH:
+                            if ( !parse_length(value, enclosure.Length) )
+                                malformed = true;
+                            break;
+                        case NAME_DECOMPRESSED_LENGTH:
+                            if ( !parse_length(value, enclosure.DecompressedLength) )
+                                malformed = true;
+                            break;
+                        case NAME_SHA256:
+                            enclosure.Sha256 = value;
+                            break;
+                        case NAME_CHUNK_MANIFEST:
+                            enclosure.ChunkManifestURL = value;
+                            break;
+                        case NAME_CHUNK_MANIFEST_SIGNATURE:
+                            enclosure.ChunkManifestSignature = value;
+                            break;
+
+                        // legacy syntax where version info was on enclosure, not item:
+                        case NAME_VERSION:
+                            item.Version = value;
+                            break;
+                        case NAME_SHORTVERSION:
+                            item.ShortVersionString = value;
+                            break;
+
+                        default:
+                            break;
+                    }
+                }
+
+                // note: we intentionally include incompatible enclosures in the list so that
+                // we can check for that case later in OnEndElement() and skip the entire <item>
+                ctxt.in_enclosure++;
+                // malformed enclosures can't be trusted to match the file, so skip them
+                ctxt.enclosure_added = enclosure.IsValid() && !malformed;
+                if ( ctxt.enclosure_added )
+                    ctxt.enclosures.push_back(std::move(enclosure));
+                break;
             }
 
-			// note: we intentionally include incompatible enclosures in the list so that
-			// we can check for that case later in OnEndElement() and skip the entire <item>
-			if (enclosure.IsValid())
-				ctxt.enclosures.push_back(enclosure);
+            case NAME_MIRROR:
+                if ( !ctxt.in_enclosure || !ctxt.enclosure_added )
+                    break;
+                for ( int i = 0; attrs[i]; i += 2 )
+                {
+                    if ( lookup_name(attrs[i]) == NAME_URL && *attrs[i + 1] )
+                        ctxt.enclosures.back().MirrorURLs.push_back(attrs[i + 1]);
+                }
+                break;
+
+            case NAME_CRITICAL_UPDATE:
+                ctxt.current.CriticalUpdate = true;
+                break;
+
+            default:
+                break;
         }
-        else if (strcmp(name, NODE_CRITICAL_UPDATE) == 0)
+    }
+    else if ( ctxt.in_channel )
+    {
+        switch ( tag )
         {
-            ctxt.current.CriticalUpdate = true;
+            case NAME_NOTIFICATIONS:
+                for ( int i = 0; attrs[i]; i += 2 )
+                {
+                    if ( lookup_name(attrs[i]) == NAME_URL )
+                        ctxt.channel.NotificationURL = attrs[i + 1];
+                }
+                break;
+
+            case NAME_APPEND_ONLY:
+                ctxt.channel.AppendOnly = true;
+                break;
+
+            default:
+                break;
         }
     }
 }
@@ -319,69 +645,91 @@ void XMLCALL OnStartElement(void *data, const char *name, const char **attrs)
 void XMLCALL OnEndElement(void *data, const char *name)
 {
     ContextData& ctxt = *static_cast<ContextData*>(data);
+    const XmlName tag = lookup_name(name);
 
-    if (ctxt.in_item)
+    if ( ctxt.in_item )
     {
-        if (strcmp(name, NODE_RELNOTES) == 0)
-        {
-            ctxt.in_relnotes--;
-        }
-        else if (strcmp(name, NODE_TITLE) == 0)
-        {
-            ctxt.in_title--;
-        }
-        else if (strcmp(name, NODE_DESCRIPTION) == 0)
-        {
-            ctxt.in_description--;
-        }
-        else if (strcmp(name, NODE_MIN_OS_VERSION) == 0)
-        {
-            ctxt.in_min_os_version--;
-        }
-        else if (strcmp(name, NODE_LINK) == 0)
-        {
-            ctxt.in_link--;
-        }
-        else if (strcmp(name, NODE_VERSION) == 0)
+        switch ( tag )
         {
-            ctxt.in_version--;
-        }
-        else if (strcmp(name, NODE_SHORTVERSION) == 0)
-        {
-            ctxt.in_shortversion--;
-        }
-        else if (strcmp(name, NODE_DSASIGNATURE) == 0)
-        {
-            ctxt.in_dsasignature--;
-        }
-        else if (strcmp(name, NODE_ITEM) == 0)
-        {
-            ctxt.in_item--;
-
-            Appcast& item = ctxt.current;
-
-			if (!ctxt.legacy_dsa_signature.empty() && item.enclosure.DsaSignature.empty())
-				item.enclosure.DsaSignature = ctxt.legacy_dsa_signature;
-
-			if (!ctxt.enclosures.empty())
+            case NAME_RELNOTES:
+                if ( --ctxt.in_relnotes == 0 )
+                    trim_whitespace(ctxt.current.ReleaseNotesURL);
+                break;
+
+            case NAME_TITLE:
+                if ( --ctxt.in_title == 0 )
+                    set_text_source(ctxt, ctxt.current.Title);
+                break;
+
+            case NAME_DESCRIPTION:
+                if ( --ctxt.in_description == 0 )
+                    set_text_source(ctxt, ctxt.current.Description);
+                break;
+
+            case NAME_MIN_OS_VERSION:
+                ctxt.in_min_os_version--;
+                break;
+
+            case NAME_LINK:
+                if ( --ctxt.in_link == 0 )
+                    trim_whitespace(ctxt.current.WebBrowserURL);
+                break;
+
+            case NAME_VERSION:
+                ctxt.in_version--;
+                break;
+
+            case NAME_SHORTVERSION:
+                ctxt.in_shortversion--;
+                break;
+
+            case NAME_DSASIGNATURE:
+                if ( --ctxt.in_dsasignature == 0 )
+                    trim_whitespace(ctxt.legacy_dsa_signature);
+                break;
+
+            case NAME_ENCLOSURE:
+                ctxt.in_enclosure--;
+                break;
+
+            case NAME_ITEM:
             {
-                item.enclosure = find_best_enclosure_for_os_arch(ctxt.enclosures);
-				if (!item.enclosure.IsValid())
-				{
-					// There are enclosures (e.g. weblink is not used), but all enclosures are
-                    // incompatible. This means the <item> is not meant for this OS and should be
-                    // skipped (as Sparkle does; there may be another <item> for us).
-                    return;
-				}
+                ctxt.in_item--;
+
+                Appcast& item = ctxt.current;
+
+                item.SourceEnd = current_content_offset(ctxt);
+                ctxt.channel.ItemsEnd = item.SourceEnd;
+
+                if ( !ctxt.legacy_dsa_signature.empty() && item.enclosure.DsaSignature.empty() )
+                    item.enclosure.DsaSignature = ctxt.legacy_dsa_signature;
+
+                if ( !ctxt.enclosures.empty() )
+                {
+                    merge_mirror_enclosures(ctxt.enclosures);
+                    Appcast::Enclosure *best = find_best_enclosure_for_os_arch(ctxt.enclosures);
+                    if ( !best )
+                    {
+                        // There are enclosures (e.g. weblink is not used), but all enclosures are
+                        // incompatible. This means the <item> is not meant for this OS and should be
+                        // skipped (as Sparkle does; there may be another <item> for us).
+                        break;
+                    }
+                    item.enclosure = std::move(*best);
+                }
+
+                if ( item.IsValid() && is_compatible_with_windows_version(item) )
+                {
+                    ctxt.all_items.push_back(std::move(item));
+                }
+                break;
             }
 
-            if (item.IsValid() && is_compatible_with_windows_version(item))
-            {
-                ctxt.all_items.push_back(item);
-            }
+            default:
+                break;
         }
     }
-    else if (strcmp(name, NODE_CHANNEL) == 0 )
+    else if ( tag == NAME_CHANNEL )
     {
         ctxt.in_channel--;
         // we've reached the end of <channel> element,
@@ -399,20 +747,20 @@ void XMLCALL OnText(void *data, const char *s, int len)
     if (ctxt.in_relnotes)
     {
         item.ReleaseNotesURL.append(s, len);
-        trim_whitespace(item.ReleaseNotesURL);
     }
     else if (ctxt.in_title)
     {
-        item.Title.append(s, len);
+        if (!ctxt.lazy_text)
+            item.Title.Append(s, len);
     }
     else if (ctxt.in_description)
     {
-        item.Description.append(s, len);
+        if (!ctxt.lazy_text)
+            item.Description.Append(s, len);
     }
     else if (ctxt.in_link)
     {
         item.WebBrowserURL.append(s, len);
-        trim_whitespace(item.WebBrowserURL);
     }
     else if (ctxt.in_version)
     {
@@ -424,7 +772,7 @@ void XMLCALL OnText(void *data, const char *s, int len)
     }
     else if (ctxt.in_dsasignature)
     {
-        ctxt.legacy_dsa_signature.assign(s, len);
+        ctxt.legacy_dsa_signature.append(s, len);
     }
     else if (ctxt.in_min_os_version)
     {
@@ -432,26 +780,61 @@ void XMLCALL OnText(void *data, const char *s, int len)
     }
 }
 
-} // anonymous namespace
 
+// Result of parsing a feed or a part of it.
+struct ParsedFeed
+{
+    std::vector<Appcast> items;
+    AppcastChannel channel;
+};
 
-/*--------------------------------------------------------------------------*
-                               Appcast class
- *--------------------------------------------------------------------------*/
 
-std::vector<Appcast> Appcast::Load(const std::string& xml)
+// Parses the [begin, end) part of the feed. If it isn't the entire feed,
+// header and footer must make it well-formed XML: the header must contain
+// the XML declaration and <channel> start tag (with its ancestors) and the
+// footer the corresponding end tags.
+void parse_feed(const std::shared_ptr<const std::string>& xml_,
+                size_t begin, size_t end,
+                const std::string& header, const std::string& footer,
+                ParsedFeed& out)
 {
+    const std::string& xml = *xml_;
+
     XML_Parser p = XML_ParserCreateNS(NULL, NS_SEP);
     if ( !p )
         throw std::runtime_error("Failed to create XML parser.");
 
-    ContextData ctxt(p);
+    ContextData ctxt(p, xml_);
+    ctxt.header_length = header.size();
+    ctxt.data_begin = begin;
+
+    // Texts are decoded lazily by parsing them again on their own, which
+    // only works with ASCII-compatible encodings; check for UTF-16 BOM:
+    if ( !xml.empty() && (xml[0] == '\xFE' || xml[0] == '\xFF' || xml[0] == '\0') )
+        ctxt.lazy_text = false;
 
     XML_SetUserData(p, &ctxt);
+    XML_SetXmlDeclHandler(p, OnXmlDecl);
     XML_SetElementHandler(p, OnStartElement, OnEndElement);
     XML_SetCharacterDataHandler(p, OnText);
 
-    XML_Status st = XML_Parse(p, xml.c_str(), (int)xml.size(), XML_TRUE);
+    // parsing is suspended after </channel>, so stop at that point too
+    XML_Status st = XML_STATUS_OK;
+    if ( !header.empty() )
+        st = XML_Parse(p, header.data(), (int)header.size(), XML_FALSE);
+    if ( st == XML_STATUS_OK )
+        st = XML_Parse(p, xml.data() + begin, (int)(end - begin), footer.empty());
+    if ( !footer.empty() )
+    {
+        // the part must not contain </channel>, it ends the feed
+        if ( st == XML_STATUS_SUSPENDED )
+        {
+            XML_ParserFree(p);
+            throw std::runtime_error("Unexpected end of channel.");
+        }
+        if ( st == XML_STATUS_OK )
+            st = XML_Parse(p, footer.data(), (int)footer.size(), XML_TRUE);
+    }
 
     if ( st == XML_STATUS_ERROR )
     {
@@ -463,12 +846,371 @@ std::vector<Appcast> Appcast::Load(const std::string& xml)
 
     XML_ParserFree(p);
 
-    if (ctxt.all_items.empty())
-        return {}; // invalid
+    out.items = std::move(ctxt.all_items);
+    out.channel = ctxt.channel;
+}
+
+
+// Feeds smaller than this are always parsed on a single thread
+const size_t PARALLEL_PARSE_MIN_SIZE = 4 * 1024 * 1024;
+
+// Minimal amount of data for a parsing thread
+const size_t PARALLEL_PARSE_MIN_PART = 1024 * 1024;
+
+const size_t PARALLEL_PARSE_MAX_THREADS = 16;
+
+
+// Beginning of the feed, up to the <channel> start tag.
+struct FeedHead
+{
+    // end of the XML declaration (and BOM), if any
+    size_t prolog_end;
+
+    // start tags of <channel> and its ancestors, and matching end tags
+    std::string open_tags, close_tags;
+
+    // end of the <channel> start tag
+    size_t channel_content;
+};
+
+
+// Does the tag declare a default namespace (xmlns="...")?
+bool declares_default_namespace(const std::string& tag)
+{
+    for ( size_t pos = tag.find("xmlns"); pos != std::string::npos; pos = tag.find("xmlns", pos + 5) )
+    {
+        const size_t next = tag.find_first_not_of(" \t\r\n", pos + 5);
+        if ( next != std::string::npos && tag[next] == '=' )
+            return true;
+    }
+    return false;
+}
+
+
+// Finds the <channel> start tag and its ancestors without parsing the XML.
+//
+// Only tags, comments and processing instructions are recognized, which is
+// enough for well-formed XML; malformed XML is caught when parsing the parts
+// later. Returns false if the feed uses constructs the parts couldn't be
+// parsed on their own with, i.e. DTD (which may define entities) or
+// a default namespace.
+bool scan_feed_head(const std::string& xml, FeedHead& head)
+{
+    struct OpenTag
+    {
+        size_t begin, end;
+        size_t name_begin, name_end;
+    };
+    std::vector<OpenTag> open;
+
+    size_t pos = 0;
+    if ( xml.compare(0, 3, "\xEF\xBB\xBF") == 0 )
+        pos = 3;
+    if ( xml.compare(pos, 5, "<?xml") == 0 )
+    {
+        pos = xml.find("?>", pos);
+        if ( pos == std::string::npos )
+            return false;
+        pos += 2;
+    }
+    head.prolog_end = pos;
+
+    for ( ;; )
+    {
+        pos = xml.find('<', pos);
+        if ( pos == std::string::npos )
+            return false;
+
+        const char *skip_to = NULL;
+        if ( xml.compare(pos, 4, "<!--") == 0 )
+            skip_to = "-->";
+        else if ( xml.compare(pos, 2, "<?") == 0 )
+            skip_to = "?>";
+        else if ( xml.compare(pos, 2, "<!") == 0 )
+            return false; // DOCTYPE or CDATA, neither is expected before <channel>
+
+        if ( skip_to )
+        {
+            pos = xml.find(skip_to, pos + 2);
+            if ( pos == std::string::npos )
+                return false;
+            pos += strlen(skip_to);
+            continue;
+        }
+
+        OpenTag tag;
+        tag.begin = pos;
+
+        const bool end_tag = (pos + 1 < xml.size() && xml[pos + 1] == '/');
+        tag.name_begin = pos + (end_tag ? 2 : 1);
+        tag.name_end = xml.find_first_of(" \t\r\n/>", tag.name_begin);
+        if ( tag.name_end == std::string::npos )
+            return false;
+
+        // find the end of the tag, '>' may be in attribute values
+        char quote = 0;
+        for ( pos = tag.name_end; pos < xml.size(); pos++ )
+        {
+            const char c = xml[pos];
+            if ( quote )
+            {
+                if ( c == quote )
+                    quote = 0;
+            }
+            else if ( c == '"' || c == '\'' )
+                quote = c;
+            else if ( c == '>' )
+                break;
+        }
+        if ( pos == xml.size() )
+            return false;
+        tag.end = ++pos;
+
+        if ( end_tag )
+        {
+            if ( open.empty() )
+                return false;
+            open.pop_back();
+            continue;
+        }
+
+        if ( xml[tag.end - 2] == '/' )
+            continue; // empty element
+
+        open.push_back(tag);
+
+        if ( xml.compare(tag.name_begin, tag.name_end - tag.name_begin, "channel") == 0 )
+            break;
+    }
+
+    for ( auto& t : open )
+    {
+        const std::string text(xml, t.begin, t.end - t.begin);
+        if ( declares_default_namespace(text) )
+            return false;
+        head.open_tags += text;
+        head.close_tags.insert(0, "</" + xml.substr(t.name_begin, t.name_end - t.name_begin) + ">");
+    }
+    head.channel_content = pos;
+
+    return true;
+}
+
+
+// Finds an <item> start tag at or after pos, following another tag (e.g.
+// </item>); returns npos if there's none.
+//
+// The tag may actually be in a comment, CDATA section or nested deeper than
+// in <channel>; splitting the feed at such point makes one of the parts
+// malformed, so it will be detected.
+size_t find_item_tag(const std::string& xml, size_t pos)
+{
+    for ( pos = xml.find("<item", pos); pos != std::string::npos; pos = xml.find("<item", pos + 5) )
+    {
+        if ( pos + 5 >= xml.size() || !strchr(" \t\r\n/>", xml[pos + 5]) )
+            continue;
+        const size_t prev = xml.find_last_not_of(" \t\r\n", pos - 1);
+        if ( prev != std::string::npos && xml[prev] == '>' )
+            return pos;
+    }
+    return std::string::npos;
+}
+
+
+// Parses a part of the feed on its own thread.
+class FeedPartParser : public Thread
+{
+public:
+    FeedPartParser(const std::shared_ptr<const std::string>& xml,
+                   size_t begin, size_t end,
+                   const std::string& header, const std::string& footer)
+        : Thread("WinSparkle appcast parser"),
+          m_xml(xml), m_begin(begin), m_end(end),
+          m_header(header), m_footer(footer),
+          m_succeeded(false)
+    {}
+
+    // Only valid after the thread finished:
+    bool Succeeded() const { return m_succeeded; }
+    ParsedFeed& GetResult() { return m_result; }
+
+protected:
+    virtual void Run()
+    {
+        SignalReady();
+
+        try
+        {
+            parse_feed(m_xml, m_begin, m_end, m_header, m_footer, m_result);
+            m_succeeded = true;
+        }
+        catch ( ... )
+        {
+            // the feed will be parsed again as a whole to report the error
+        }
+    }
+
+    virtual bool IsJoinable() const { return true; }
+
+private:
+    std::shared_ptr<const std::string> m_xml;
+    size_t m_begin, m_end;
+    const std::string& m_header;
+    const std::string& m_footer;
+    bool m_succeeded;
+    ParsedFeed m_result;
+};
+
+
+// Parses large feeds by splitting them at <item> boundaries and parsing the
+// parts on several threads; the results are merged in feed order. Returns
+// false if the feed wasn't parsed, because it's too small, it can't be split
+// or there was an error.
+bool parse_feed_in_parallel(const std::shared_ptr<const std::string>& xml, ParsedFeed& out)
+{
+    const size_t size = xml->size();
+    if ( size < PARALLEL_PARSE_MIN_SIZE )
+        return false;
+
+    // parts are parsed with a header copied from the beginning of the feed,
+    // which only works with ASCII-compatible encodings; check for UTF-16 BOM:
+    const char c = (*xml)[0];
+    if ( c == '\xFE' || c == '\xFF' || c == '\0' )
+        return false;
+
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    const size_t threads = (std::min)((std::min)(size_t(si.dwNumberOfProcessors), PARALLEL_PARSE_MAX_THREADS),
+                                      size / PARALLEL_PARSE_MIN_PART);
+    if ( threads < 2 )
+        return false;
+
+    FeedHead head;
+    if ( !scan_feed_head(*xml, head) )
+        return false;
+
+    // split into parts of about the same size
+    std::vector<size_t> bounds(1, 0);
+    for ( size_t i = 1; i < threads; i++ )
+    {
+        const size_t pos = find_item_tag(*xml, (std::max)(i * size / threads, head.channel_content));
+        if ( pos == std::string::npos )
+            break;
+        if ( pos > bounds.back() )
+            bounds.push_back(pos);
+    }
+    bounds.push_back(size);
+    if ( bounds.size() < 3 )
+        return false;
+
+    // the first part starts with the feed's own header and the last one
+    // ends with its own footer
+    const std::string header = xml->substr(0, head.prolog_end) + head.open_tags;
+    const std::string none;
+
+    std::vector<FeedPartParser*> parsers;
+    bool ok = true;
+    try
+    {
+        for ( size_t i = 0; i + 1 < bounds.size(); i++ )
+        {
+            const bool first = (i == 0);
+            const bool last = (i + 2 == bounds.size());
+            std::unique_ptr<FeedPartParser> parser(new FeedPartParser(xml, bounds[i], bounds[i + 1],
+                                                                      first ? none : header,
+                                                                      last ? none : head.close_tags));
+            parser->Start();
+            parsers.push_back(parser.release());
+        }
+    }
+    catch ( ... )
+    {
+        // couldn't start the threads, parse the usual way
+        ok = false;
+    }
+
+    for ( auto p : parsers )
+    {
+        p->Join();
+        ok = ok && p->Succeeded();
+    }
+
+    if ( ok )
+    {
+        for ( auto p : parsers )
+        {
+            ParsedFeed& part = p->GetResult();
+
+            std::move(part.items.begin(), part.items.end(), std::back_inserter(out.items));
+
+            if ( !part.channel.NotificationURL.empty() )
+                out.channel.NotificationURL = part.channel.NotificationURL;
+            if ( part.channel.AppendOnly )
+                out.channel.AppendOnly = true;
+            if ( part.channel.ItemsEnd )
+            {
+                if ( !out.channel.ItemsEnd )
+                    out.channel.ItemsBegin = part.channel.ItemsBegin;
+                out.channel.ItemsEnd = part.channel.ItemsEnd;
+            }
+        }
+    }
+
+    for ( auto p : parsers )
+        delete p;
+
+    return ok;
+}
+
+} // anonymous namespace
+
+
+/*--------------------------------------------------------------------------*
+                               Appcast class
+ *--------------------------------------------------------------------------*/
+
+std::string AppcastText::Get() const
+{
+    if ( !m_source )
+        return m_text;
+
+    // Parse the raw content again, preceded by the document's XML
+    // declaration so that the encoding is the same:
+    std::string fragment(*m_source, 0, m_prologLength);
+    fragment += "<t>";
+    fragment.append(*m_source, m_begin, m_end - m_begin);
+    fragment += "</t>";
+
+    std::string text;
+
+    XML_Parser p = XML_ParserCreate(NULL);
+    if ( !p )
+        throw std::runtime_error("Failed to create XML parser.");
+
+    XML_SetUserData(p, &text);
+    XML_SetCharacterDataHandler(p, OnFragmentText);
+    // The content was already parsed successfully as part of the feed, so
+    // errors can only be caused by context missing here (e.g. entities
+    // declared in DTD). Use as much of the text as possible in that case.
+    XML_Parse(p, fragment.data(), (int)fragment.size(), XML_TRUE);
+    XML_ParserFree(p);
+
+    return text;
+}
+
+
+std::vector<Appcast> Appcast::Load(const std::shared_ptr<const std::string>& xml, AppcastChannel *channel)
+{
+    ParsedFeed feed;
+    if ( !parse_feed_in_parallel(xml, feed) )
+        parse_feed(xml, 0, xml->size(), std::string(), std::string(), feed);
+
+    if (channel)
+        *channel = feed.channel;
 
-	// the items were already filtered to only include those compatible with the current OS + arch
-	// and meeting minimum OS version requirements, so we can just return the first one
-	return std::move(ctxt.all_items);
+    // the items were already filtered to only include those compatible with the current OS + arch
+    // and meeting minimum OS version requirements, so we can just return them
+    return std::move(feed.items);
 }
 
 } // namespace winsparkle
@@ -26,6 +26,8 @@
 #ifndef _appcast_h_
 #define _appcast_h_
 
+#include <memory>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -33,6 +35,95 @@
 namespace winsparkle
 {
 
+/**
+    Text content of an appcast element, decoded only when needed.
+
+    Long texts such as inline release notes are only used for the one
+    item shown to the user, so instead of decoding them for all items,
+    only their location in the appcast data is remembered.
+ */
+class AppcastText
+{
+public:
+    AppcastText() : m_prologLength(0), m_begin(0), m_end(0) {}
+
+    /// Sets already decoded text.
+    AppcastText& operator=(const std::string& text)
+    {
+        m_source.reset();
+        m_text = text;
+        return *this;
+    }
+
+    /// Appends already decoded text.
+    void Append(const char *text, size_t len) { m_text.append(text, len); }
+
+    /**
+        Refers to raw content of an element in XML data.
+
+        @param source        The XML data, kept alive by the object.
+        @param prologLength  Length of XML declaration at the start of @a source.
+        @param begin         Offset of the element's content.
+        @param end           Offset just past the element's content.
+     */
+    void SetSource(const std::shared_ptr<const std::string>& source,
+                   size_t prologLength, size_t begin, size_t end)
+    {
+        m_source = source;
+        m_prologLength = prologLength;
+        m_begin = begin;
+        m_end = end;
+        m_text.clear();
+    }
+
+    /// Returns true if there's no text (without decoding it).
+    bool empty() const { return m_source ? m_begin == m_end : m_text.empty(); }
+
+    /// Returns the decoded text.
+    std::string Get() const;
+
+    /**
+        Gets the raw XML content, if the text refers to it.
+
+        @param xml           Set to the XML declaration followed by the content.
+        @param prologLength  Set to the length of the XML declaration.
+
+        @return false if the text is stored decoded.
+     */
+    bool GetSource(std::string& xml, size_t& prologLength) const
+    {
+        if ( !m_source )
+            return false;
+        xml.assign(*m_source, 0, m_prologLength);
+        xml.append(*m_source, m_begin, m_end - m_begin);
+        prologLength = m_prologLength;
+        return true;
+    }
+
+private:
+    std::shared_ptr<const std::string> m_source;
+    size_t m_prologLength, m_begin, m_end;
+    std::string m_text;
+};
+
+/**
+    Information about the appcast feed itself, rather than its items.
+ */
+struct AppcastChannel
+{
+    /// URL of server-sent events stream announcing new releases
+    std::string NotificationURL;
+
+    /// Does the feed only grow by adding new items at its end?
+    bool AppendOnly = false;
+
+    /// Offset of the first <item> in the XML data, or 0 if there are none
+    size_t ItemsBegin = 0;
+
+    /// Offset just past the last </item> in the XML data, or 0 if there are none
+    size_t ItemsEnd = 0;
+};
+
 /**
     This class contains information from the appcast.
  */
@@ -49,10 +140,10 @@ struct Appcast
     std::string WebBrowserURL;
 
     /// Title of the update
-    std::string Title;
+    AppcastText Title;
 
     /// Description of the update
-    std::string Description;
+    AppcastText Description;
 
     // Minimum OS version required for update
     std::string MinOSVersion;
@@ -60,23 +151,57 @@ struct Appcast
     // CriticalUpdate?
     bool CriticalUpdate = false;
 
+    /// Location of the <item> element in the XML data it was loaded from
+    size_t SourceBegin = 0;
+    size_t SourceEnd = 0;
+
     struct Enclosure
     {
         /// URL of the update
         std::string DownloadURL;
 
+        /// Alternative URLs of the same file
+        std::vector<std::string> MirrorURLs;
+
         /// Signing signature of the update
         std::string DsaSignature;
 
         /// Signing EdDSA signature of the update
         std::string EdDsaSignature;
 
+        /// EdDSA signature of the update's tree hash
+        std::string EdDsaTreeSignature;
+
+        /// ID of the EdDSA key the update was signed with, if specified
+        std::string EdKeyId;
+
         // Operating system
         std::string OS;
 
         // Arguments passed on the the updater executable
         std::string InstallerArguments;
 
+        // Compression of the downloaded file (e.g. "gzip") or empty if none
+        std::string Compression;
+
+        // Is the signature of compressed data rather than of decompressed file?
+        bool SignatureOfCompressedData = false;
+
+        // Size of the decompressed file, or 0 if unknown
+        uint64_t DecompressedLength = 0;
+
+        // Size of the file as downloaded, or 0 if unknown
+        uint64_t Length = 0;
+
+        // SHA-256 digest of the file as downloaded (hex), or empty if none
+        std::string Sha256;
+
+        // URL of the manifest with digests of the file's chunks, or empty
+        std::string ChunkManifestURL;
+
+        // EdDSA signature of the chunk manifest
+        std::string ChunkManifestSignature;
+
 		bool IsValid() const { return !DownloadURL.empty(); }
     };
 
@@ -95,9 +220,11 @@ struct Appcast
         Returns emty list if no error ocurred, but there was no usable update
         in the appcast.
 
-        @param xml Appcast feed data.
+        @param xml Appcast feed data. Loaded items may keep referring to it.
+        @param channel If not NULL, filled with channel-level information.
      */
-    static std::vector<Appcast> Load(const std::string& xml);
+    static std::vector<Appcast> Load(const std::shared_ptr<const std::string>& xml,
+                                     AppcastChannel *channel = NULL);
 
     /// Returns true if the struct constains valid data.
     bool IsValid() const { return !Version.empty() && (HasDownload() || !WebBrowserURL.empty()); }
@@ -0,0 +1,170 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "base64.h"
+
+#include <stdexcept>
+
+namespace winsparkle
+{
+
+namespace
+{
+
+const char BASE64_DIGITS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Values of characters in base64 encoded data
+enum
+{
+    B64_WHITESPACE = 0x40,
+    B64_PADDING    = 0x41,
+    B64_INVALID    = 0xFF
+};
+
+// Maps characters to their values
+struct Base64DecodingTable
+{
+    unsigned char values[256];
+
+    Base64DecodingTable()
+    {
+        for ( int i = 0; i < 256; i++ )
+            values[i] = B64_INVALID;
+        for ( int i = 0; i < 64; i++ )
+            values[(unsigned char)BASE64_DIGITS[i]] = (unsigned char)i;
+        values['='] = B64_PADDING;
+        values[' '] = values['\t'] = values['\r'] = values['\n'] = B64_WHITESPACE;
+    }
+};
+
+const Base64DecodingTable g_base64Table;
+
+} // anonymous namespace
+
+
+std::string Base64Encode(const void *data, size_t len)
+{
+    const unsigned char *in = static_cast<const unsigned char*>(data);
+
+    std::string out;
+    out.reserve((len + 2) / 3 * 4);
+
+    for ( ; len >= 3; in += 3, len -= 3 )
+    {
+        const unsigned n = unsigned(in[0]) << 16 | unsigned(in[1]) << 8 | in[2];
+        out += BASE64_DIGITS[n >> 18];
+        out += BASE64_DIGITS[(n >> 12) & 0x3F];
+        out += BASE64_DIGITS[(n >> 6) & 0x3F];
+        out += BASE64_DIGITS[n & 0x3F];
+    }
+
+    if ( len )
+    {
+        const unsigned n = unsigned(in[0]) << 16 | (len == 2 ? unsigned(in[1]) << 8 : 0);
+        out += BASE64_DIGITS[n >> 18];
+        out += BASE64_DIGITS[(n >> 12) & 0x3F];
+        out += len == 2 ? BASE64_DIGITS[(n >> 6) & 0x3F] : '=';
+        out += '=';
+    }
+
+    return out;
+}
+
+
+std::string Base64Decode(const std::string& base64)
+{
+    const std::runtime_error invalid("Failed to decode base64 string");
+
+    std::string out;
+    out.reserve(base64.size() / 4 * 3);
+
+    unsigned n = 0;      // bits of the current quantum
+    int digits = 0;      // number of its digits read so far
+    int padding = 0;     // number of padding characters seen
+
+    for ( std::string::const_iterator i = base64.begin(); i != base64.end(); ++i )
+    {
+        const unsigned char value = g_base64Table.values[(unsigned char)*i];
+        switch ( value )
+        {
+            case B64_WHITESPACE:
+                continue;
+
+            case B64_PADDING:
+                // padding may only complete the last quantum, which must
+                // have at least two digits
+                if ( digits + padding < 2 || digits + padding >= 4 )
+                    throw invalid;
+                padding++;
+                continue;
+
+            case B64_INVALID:
+                throw invalid;
+        }
+
+        if ( padding )
+            throw invalid;
+
+        n = n << 6 | value;
+        if ( ++digits == 4 )
+        {
+            out += char(n >> 16);
+            out += char(n >> 8);
+            out += char(n);
+            n = 0;
+            digits = 0;
+        }
+    }
+
+    if ( digits == 0 )
+    {
+        if ( padding )
+            throw invalid;
+        return out;
+    }
+
+    // the last quantum is incomplete: it must be padded and the unused
+    // bits must be zero, so that each value has only one encoding
+    if ( digits + padding != 4 )
+        throw invalid;
+
+    if ( digits == 2 )
+    {
+        if ( n & 0x0F )
+            throw invalid;
+        out += char(n >> 4);
+    }
+    else // digits == 3
+    {
+        if ( n & 0x03 )
+            throw invalid;
+        out += char(n >> 10);
+        out += char(n >> 2);
+    }
+
+    return out;
+}
+
+} // namespace winsparkle
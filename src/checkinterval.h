@@ -0,0 +1,50 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _checkinterval_h_
+#define _checkinterval_h_
+
+namespace winsparkle
+{
+
+/**
+    Computes the adaptive update check interval.
+
+    The interval is doubled if the feed didn't change since the last
+    check, up to @a maxInterval, and reset to @a minInterval if it did.
+
+    @param current      Interval used for the last check.
+    @param minInterval  Shortest allowed interval, used after changes.
+    @param maxInterval  Longest allowed interval.
+    @param feedChanged  Whether the feed changed since the previous check
+                        or offers a critical update.
+
+    @return Interval in seconds until the next check.
+ */
+int NextCheckInterval(int current, int minInterval, int maxInterval, bool feedChanged);
+
+} // namespace winsparkle
+
+#endif // _checkinterval_h_
@@ -0,0 +1,176 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "hashes.h"
+
+#include "error.h"
+#include "threads.h"
+
+#include <windows.h>
+#include <bcrypt.h>
+
+#ifdef _MSC_VER
+#pragma comment(lib, "bcrypt.lib")
+#endif
+
+namespace winsparkle
+{
+
+namespace
+{
+
+// CNG algorithm provider, opened on first use. Opening a provider is
+// expensive, so it is kept open for the process' lifetime.
+struct CNGProvider
+{
+    LPCWSTR algorithm;
+    bool opened;
+    BCRYPT_ALG_HANDLE handle;
+};
+
+CriticalSection g_csProviders;
+CNGProvider g_providerSHA256 = { BCRYPT_SHA256_ALGORITHM, false, NULL };
+CNGProvider g_providerSHA512 = { BCRYPT_SHA512_ALGORITHM, false, NULL };
+
+// Creates a hash object of the provider's algorithm, returns NULL if CNG
+// can't be used.
+BCRYPT_HASH_HANDLE CreateCNGHash(CNGProvider& provider)
+{
+    {
+        CriticalSectionLocker lock(g_csProviders);
+        if ( !provider.opened )
+        {
+            provider.opened = true;
+            if ( !BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&provider.handle, provider.algorithm, NULL, 0)) )
+                provider.handle = NULL;
+        }
+    }
+
+    if ( !provider.handle )
+        return NULL;
+
+    // let CNG allocate the hash object
+    BCRYPT_HASH_HANDLE hash = NULL;
+    if ( !BCRYPT_SUCCESS(BCryptCreateHash(provider.handle, &hash, NULL, 0, NULL, 0, 0)) )
+        return NULL;
+    return hash;
+}
+
+void UpdateCNGHash(BCRYPT_HASH_HANDLE hash, const void *data, size_t len)
+{
+    // BCryptHashData() takes ULONG length
+    const unsigned char *p = static_cast<const unsigned char*>(data);
+    while ( len > 0 )
+    {
+        const ULONG chunk = len > 0x40000000 ? 0x40000000 : ULONG(len);
+        if ( !BCRYPT_SUCCESS(BCryptHashData(hash, const_cast<PUCHAR>(p), chunk, 0)) )
+            throw std::runtime_error("Failed to compute hash.");
+        p += chunk;
+        len -= chunk;
+    }
+}
+
+void FinishCNGHash(BCRYPT_HASH_HANDLE hash, unsigned char *output, size_t len)
+{
+    if ( !BCRYPT_SUCCESS(BCryptFinishHash(hash, output, ULONG(len), 0)) )
+        throw std::runtime_error("Failed to compute hash.");
+}
+
+} // anonymous namespace
+
+
+/*--------------------------------------------------------------------------*
+                                SHA512Hasher
+ *--------------------------------------------------------------------------*/
+
+SHA512Hasher::SHA512Hasher() : m_cngHash(CreateCNGHash(g_providerSHA512))
+{
+    if ( !m_cngHash && sha512_init(&m_fallback) != 0 )
+        throw std::runtime_error("Failed to initialize SHA-512.");
+}
+
+
+SHA512Hasher::~SHA512Hasher()
+{
+    if ( m_cngHash )
+        BCryptDestroyHash(m_cngHash);
+}
+
+
+void SHA512Hasher::Update(const void *data, size_t len)
+{
+    if ( m_cngHash )
+        UpdateCNGHash(m_cngHash, data, len);
+    else
+        sha512_update(&m_fallback, static_cast<const unsigned char*>(data), len);
+}
+
+
+void SHA512Hasher::Final(unsigned char hash[HASH_SIZE])
+{
+    if ( m_cngHash )
+        FinishCNGHash(m_cngHash, hash, HASH_SIZE);
+    else
+        sha512_final(&m_fallback, hash);
+}
+
+
+/*static*/ void SHA512Hasher::Hash(const void *data, size_t len, unsigned char hash[HASH_SIZE])
+{
+    SHA512Hasher hasher;
+    hasher.Update(data, len);
+    hasher.Final(hash);
+}
+
+
+/*--------------------------------------------------------------------------*
+                                SHA256Hasher
+ *--------------------------------------------------------------------------*/
+
+SHA256Hasher::SHA256Hasher() : m_cngHash(CreateCNGHash(g_providerSHA256))
+{
+    if ( !m_cngHash )
+        throw std::runtime_error("Failed to initialize SHA-256.");
+}
+
+
+SHA256Hasher::~SHA256Hasher()
+{
+    BCryptDestroyHash(m_cngHash);
+}
+
+
+void SHA256Hasher::Update(const void *data, size_t len)
+{
+    UpdateCNGHash(m_cngHash, data, len);
+}
+
+
+void SHA256Hasher::Final(unsigned char hash[HASH_SIZE])
+{
+    FinishCNGHash(m_cngHash, hash, HASH_SIZE);
+}
+
+} // namespace winsparkle
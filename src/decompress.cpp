@@ -0,0 +1,625 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "decompress.h"
+
+#include <stdexcept>
+#include <string.h>
+#include <wctype.h>
+
+namespace winsparkle
+{
+
+/*--------------------------------------------------------------------------*
+                              helpers
+ *--------------------------------------------------------------------------*/
+
+namespace
+{
+
+const char COMPRESSION_GZIP[] = "gzip";
+
+// gzip header flags
+const unsigned FLAG_HCRC    = 0x02;
+const unsigned FLAG_EXTRA   = 0x04;
+const unsigned FLAG_NAME    = 0x08;
+const unsigned FLAG_COMMENT = 0x10;
+
+const unsigned short LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const unsigned char LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const unsigned short DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577 };
+const unsigned char DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// order in which code length code lengths are stored
+const unsigned char CODE_LENGTH_ORDER[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+// the longest symbol: 15 bits length code, 5 extra bits, 15 bits distance
+// code and 13 extra bits; the gzip trailer guarantees this many bits follow
+// any symbol in a valid stream
+const unsigned MAX_SYMBOL_BITS = 48;
+
+// output allowed regardless of the compression ratio if its size is unknown
+const uint64_t RATIO_SLACK = 16 * 1024 * 1024;
+
+void ThrowInvalidData()
+{
+    throw std::runtime_error("Invalid compressed data.");
+}
+
+} // anonymous namespace
+
+
+/*--------------------------------------------------------------------------*
+                              GzipDecoder
+ *--------------------------------------------------------------------------*/
+
+GzipDecoder::GzipDecoder()
+    : m_state(State_Header),
+      m_in(NULL), m_inEnd(NULL), m_bits(0), m_bitCount(0),
+      m_headerPos(0), m_flags(0), m_memberDone(false),
+      m_lastBlock(false), m_remaining(0),
+      m_numLen(0), m_numDist(0), m_numCodeLen(0), m_lengthIndex(0),
+      m_window(WINDOW_SIZE),
+      m_pos(0), m_flushed(0), m_memberStart(0),
+      m_output(NULL),
+      m_expectedSize(0), m_inputSize(0),
+      m_crc(0)
+{
+    for ( uint32_t n = 0; n < 256; n++ )
+    {
+        uint32_t c = n;
+        for ( int k = 0; k < 8; k++ )
+            c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        m_crcTable[n] = c;
+    }
+}
+
+
+void GzipDecoder::Decode(const void *data, size_t len, IDownloadSink& output)
+{
+    m_in = static_cast<const unsigned char*>(data);
+    m_inEnd = m_in + len;
+    m_output = &output;
+    m_inputSize += len;
+
+    while ( Step() )
+    {
+    }
+
+    FlushOutput();
+    m_in = m_inEnd = NULL;
+}
+
+
+void GzipDecoder::Finish(IDownloadSink& output)
+{
+    m_output = &output;
+    FlushOutput();
+
+    if ( (m_state != State_Header && m_state != State_Padding) || m_headerPos != 0 || !m_memberDone )
+        throw std::runtime_error("Compressed data are truncated.");
+
+    if ( m_expectedSize && m_pos != m_expectedSize )
+        throw std::runtime_error("Decompressed data have unexpected size.");
+}
+
+
+bool GzipDecoder::Need(unsigned n)
+{
+    while ( m_bitCount < n )
+    {
+        if ( m_in == m_inEnd )
+            return false;
+        m_bits |= uint64_t(*m_in++) << m_bitCount;
+        m_bitCount += 8;
+    }
+    return true;
+}
+
+
+unsigned GzipDecoder::Bits(unsigned n)
+{
+    const unsigned value = unsigned(m_bits & ((uint64_t(1) << n) - 1));
+    m_bits >>= n;
+    m_bitCount -= n;
+    return value;
+}
+
+
+bool GzipDecoder::GetByte(unsigned& byte)
+{
+    // only used at byte boundaries, where m_bitCount is a multiple of 8
+    if ( !Need(8) )
+        return false;
+    byte = Bits(8);
+    return true;
+}
+
+
+int GzipDecoder::DecodeSymbol(const Huffman& h)
+{
+    const unsigned entry = h.fast[m_bits & ((1 << Huffman::FAST_BITS) - 1)];
+    if ( entry )
+    {
+        Bits(entry >> 9);
+        return entry & 0x1FF;
+    }
+
+    // longer code, decode it bit by bit (the caller ensured there are
+    // enough bits available)
+    uint64_t bits = m_bits;
+    int code = 0, first = 0, index = 0;
+    for ( unsigned len = 1; len < 16; len++ )
+    {
+        code |= int(bits & 1);
+        bits >>= 1;
+        const int count = h.count[len];
+        if ( code - count < first )
+        {
+            Bits(len);
+            return h.symbol[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+
+    ThrowInvalidData();
+    return -1;
+}
+
+
+void GzipDecoder::BuildHuffman(Huffman& h, const uint16_t *lengths, unsigned n)
+{
+    memset(h.count, 0, sizeof(h.count));
+    memset(h.fast, 0, sizeof(h.fast));
+
+    for ( unsigned sym = 0; sym < n; sym++ )
+        h.count[lengths[sym]]++;
+    h.count[0] = 0;
+
+    // check for an over-subscribed code; incomplete codes are allowed and
+    // only fail if an unused code is encountered
+    int left = 1;
+    for ( unsigned len = 1; len < 16; len++ )
+    {
+        left <<= 1;
+        left -= h.count[len];
+        if ( left < 0 )
+            ThrowInvalidData();
+    }
+
+    short offsets[16];
+    unsigned nextCode[16];
+    offsets[1] = 0;
+    nextCode[1] = 0;
+    for ( unsigned len = 1; len < 15; len++ )
+    {
+        offsets[len + 1] = offsets[len] + h.count[len];
+        nextCode[len + 1] = (nextCode[len] + h.count[len]) << 1;
+    }
+
+    for ( unsigned sym = 0; sym < n; sym++ )
+    {
+        const unsigned len = lengths[sym];
+        if ( !len )
+            continue;
+
+        h.symbol[offsets[len]++] = short(sym);
+
+        const unsigned code = nextCode[len]++;
+        if ( len <= Huffman::FAST_BITS )
+        {
+            // codes are stored starting with the most significant bit, but
+            // the input is consumed from the least significant one:
+            unsigned reversed = 0;
+            for ( unsigned i = 0; i < len; i++ )
+                reversed |= ((code >> i) & 1) << (len - 1 - i);
+
+            for ( unsigned i = reversed; i < (1u << Huffman::FAST_BITS); i += 1u << len )
+                h.fast[i] = uint16_t((len << 9) | sym);
+        }
+    }
+}
+
+
+void GzipDecoder::BuildDynamicTables()
+{
+    if ( m_lengths[256] == 0 )
+        ThrowInvalidData(); // no end-of-block code
+
+    BuildHuffman(m_lenCode, m_lengths, m_numLen);
+    BuildHuffman(m_distCode, m_lengths + m_numLen, m_numDist);
+}
+
+
+void GzipDecoder::FlushOutput()
+{
+    // the window is small, so this catches oversized output early enough
+    if ( m_expectedSize ? m_pos > m_expectedSize
+                        : m_pos > m_inputSize * MAX_RATIO + RATIO_SLACK )
+    {
+        throw std::runtime_error("Decompressed data are larger than expected.");
+    }
+
+    while ( m_flushed < m_pos )
+    {
+        const size_t start = size_t(m_flushed & WINDOW_MASK);
+        size_t len = size_t(m_pos - m_flushed);
+        if ( start + len > WINDOW_SIZE )
+            len = WINDOW_SIZE - start;
+
+        const unsigned char *data = &m_window[start];
+        uint32_t crc = ~m_crc;
+        for ( size_t i = 0; i < len; i++ )
+            crc = m_crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        m_crc = ~crc;
+
+        m_output->Add(data, len);
+        m_flushed += len;
+    }
+}
+
+
+// Performs one step of decoding. Returns false if more input is needed.
+bool GzipDecoder::Step()
+{
+    unsigned byte;
+
+    switch ( m_state )
+    {
+        case State_Header:
+        {
+            while ( m_headerPos < sizeof(m_header) )
+            {
+                if ( !GetByte(byte) )
+                    return false;
+                // zero padding after the last member, as written by some
+                // tools (e.g. to fill a tape block), is ignored like gzip does
+                if ( m_headerPos == 0 && byte == 0 && m_memberDone )
+                {
+                    m_state = State_Padding;
+                    return true;
+                }
+                m_header[m_headerPos++] = (unsigned char)byte;
+            }
+            m_headerPos = 0;
+
+            if ( m_header[0] != 0x1F || m_header[1] != 0x8B )
+                throw std::runtime_error("Data are not gzip-compressed.");
+            if ( m_header[2] != 8 /* deflate */ || (m_header[3] & 0xE0) )
+                throw std::runtime_error("Unsupported gzip compression format.");
+
+            m_flags = m_header[3];
+            m_memberDone = false;
+            m_memberStart = m_pos;
+            m_crc = 0;
+            m_state = State_HeaderExtraLen;
+            return true;
+        }
+
+        case State_HeaderExtraLen:
+            if ( m_flags & FLAG_EXTRA )
+            {
+                if ( !Need(16) )
+                    return false;
+                m_remaining = Bits(16);
+            }
+            m_state = State_HeaderExtra;
+            return true;
+
+        case State_HeaderExtra:
+            for ( ; m_remaining; m_remaining-- )
+            {
+                if ( !GetByte(byte) )
+                    return false;
+            }
+            m_state = State_HeaderName;
+            return true;
+
+        case State_HeaderName:
+        case State_HeaderComment:
+            if ( m_flags & (m_state == State_HeaderName ? FLAG_NAME : FLAG_COMMENT) )
+            {
+                // skip zero-terminated string
+                do
+                {
+                    if ( !GetByte(byte) )
+                        return false;
+                } while ( byte != 0 );
+            }
+            m_state = (m_state == State_HeaderName) ? State_HeaderComment : State_HeaderCrc;
+            return true;
+
+        case State_HeaderCrc:
+            if ( m_flags & FLAG_HCRC )
+            {
+                if ( !Need(16) )
+                    return false;
+                Bits(16);
+            }
+            m_state = State_BlockHeader;
+            return true;
+
+        case State_BlockHeader:
+            if ( !Need(3) )
+                return false;
+            m_lastBlock = Bits(1) != 0;
+            switch ( Bits(2) )
+            {
+                case 0:
+                    m_state = State_StoredLen;
+                    break;
+                case 1:
+                    for ( unsigned i = 0; i < 288; i++ )
+                        m_lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+                    for ( unsigned i = 0; i < 30; i++ )
+                        m_lengths[288 + i] = 5;
+                    BuildHuffman(m_lenCode, m_lengths, 288);
+                    BuildHuffman(m_distCode, m_lengths + 288, 30);
+                    m_state = State_Codes;
+                    break;
+                case 2:
+                    m_state = State_TableCounts;
+                    break;
+                default:
+                    ThrowInvalidData();
+            }
+            return true;
+
+        case State_StoredLen:
+        {
+            Bits(m_bitCount & 7); // go to byte boundary
+            if ( !Need(32) )
+                return false;
+            const unsigned len = Bits(16);
+            const unsigned nlen = Bits(16);
+            if ( len != (~nlen & 0xFFFF) )
+                ThrowInvalidData();
+            m_remaining = len;
+            m_state = State_Stored;
+            return true;
+        }
+
+        case State_Stored:
+            while ( m_remaining )
+            {
+                if ( !GetByte(byte) )
+                    return false;
+                PutByte((unsigned char)byte);
+                m_remaining--;
+                if ( m_pos - m_flushed >= FLUSH_THRESHOLD )
+                    FlushOutput();
+            }
+            m_state = m_lastBlock ? State_Trailer : State_BlockHeader;
+            return true;
+
+        case State_TableCounts:
+            if ( !Need(14) )
+                return false;
+            m_numLen = Bits(5) + 257;
+            m_numDist = Bits(5) + 1;
+            m_numCodeLen = Bits(4) + 4;
+            if ( m_numLen > 286 || m_numDist > 30 )
+                ThrowInvalidData();
+            memset(m_lengths, 0, sizeof(m_lengths));
+            m_lengthIndex = 0;
+            m_state = State_CodeLengthCodes;
+            return true;
+
+        case State_CodeLengthCodes:
+            for ( ; m_lengthIndex < m_numCodeLen; m_lengthIndex++ )
+            {
+                if ( !Need(3) )
+                    return false;
+                m_lengths[CODE_LENGTH_ORDER[m_lengthIndex]] = uint16_t(Bits(3));
+            }
+            BuildHuffman(m_codeLenCode, m_lengths, 19);
+            memset(m_lengths, 0, sizeof(m_lengths));
+            m_lengthIndex = 0;
+            m_state = State_CodeLengths;
+            return true;
+
+        case State_CodeLengths:
+            while ( m_lengthIndex < m_numLen + m_numDist )
+            {
+                // up to 7 bits of code and 7 extra bits
+                if ( !Need(14) )
+                    return false;
+
+                const int sym = DecodeSymbol(m_codeLenCode);
+                if ( sym < 16 )
+                {
+                    m_lengths[m_lengthIndex++] = uint16_t(sym);
+                    continue;
+                }
+
+                unsigned value = 0, repeat;
+                if ( sym == 16 )
+                {
+                    if ( m_lengthIndex == 0 )
+                        ThrowInvalidData();
+                    value = m_lengths[m_lengthIndex - 1];
+                    repeat = 3 + Bits(2);
+                }
+                else if ( sym == 17 )
+                {
+                    repeat = 3 + Bits(3);
+                }
+                else
+                {
+                    repeat = 11 + Bits(7);
+                }
+
+                if ( m_lengthIndex + repeat > m_numLen + m_numDist )
+                    ThrowInvalidData();
+                while ( repeat-- )
+                    m_lengths[m_lengthIndex++] = uint16_t(value);
+            }
+            BuildDynamicTables();
+            m_state = State_Codes;
+            return true;
+
+        case State_Codes:
+            for ( ;; )
+            {
+                if ( !Need(MAX_SYMBOL_BITS) )
+                    return false;
+
+                int sym = DecodeSymbol(m_lenCode);
+                if ( sym < 256 )
+                {
+                    PutByte((unsigned char)sym);
+                }
+                else if ( sym == 256 )
+                {
+                    m_state = m_lastBlock ? State_Trailer : State_BlockHeader;
+                    return true;
+                }
+                else
+                {
+                    sym -= 257;
+                    if ( sym >= 29 )
+                        ThrowInvalidData();
+                    unsigned len = LENGTH_BASE[sym] + Bits(LENGTH_EXTRA[sym]);
+
+                    const int dsym = DecodeSymbol(m_distCode);
+                    if ( dsym >= 30 )
+                        ThrowInvalidData();
+                    const unsigned dist = DIST_BASE[dsym] + Bits(DIST_EXTRA[dsym]);
+                    if ( dist > m_pos - m_memberStart )
+                        ThrowInvalidData();
+
+                    while ( len-- )
+                    {
+                        m_window[m_pos & WINDOW_MASK] = m_window[(m_pos - dist) & WINDOW_MASK];
+                        m_pos++;
+                    }
+                }
+
+                if ( m_pos - m_flushed >= FLUSH_THRESHOLD )
+                    FlushOutput();
+            }
+
+        case State_Trailer:
+        {
+            Bits(m_bitCount & 7); // go to byte boundary
+            while ( m_headerPos < 8 )
+            {
+                if ( !GetByte(byte) )
+                    return false;
+                m_header[m_headerPos++] = (unsigned char)byte;
+            }
+            m_headerPos = 0;
+
+            FlushOutput();
+
+            const uint32_t crc = m_header[0] | (m_header[1] << 8) | (m_header[2] << 16) | (uint32_t(m_header[3]) << 24);
+            const uint32_t size = m_header[4] | (m_header[5] << 8) | (m_header[6] << 16) | (uint32_t(m_header[7]) << 24);
+            if ( crc != m_crc || size != uint32_t(m_pos - m_memberStart) )
+                throw std::runtime_error("Compressed data are corrupted.");
+
+            m_memberDone = true;
+            m_state = State_Header;
+            return true;
+        }
+
+        case State_Padding:
+            for ( ;; )
+            {
+                if ( !GetByte(byte) )
+                    return false;
+                if ( byte != 0 )
+                    throw std::runtime_error("Unexpected data after compressed data.");
+            }
+    }
+
+    return false;
+}
+
+
+/*--------------------------------------------------------------------------*
+                        DecompressingDownloadSink
+ *--------------------------------------------------------------------------*/
+
+DecompressingDownloadSink::DecompressingDownloadSink(IDownloadSink& target, const std::string& compression,
+                                                     uint64_t size)
+    : m_target(target)
+{
+    if ( !IsSupported(compression) )
+        throw std::runtime_error("Unsupported compression format \"" + compression + "\".");
+
+    m_decoder.SetExpectedSize(size);
+}
+
+
+/* static */
+bool DecompressingDownloadSink::IsSupported(const std::string& compression)
+{
+    return compression == COMPRESSION_GZIP;
+}
+
+
+void DecompressingDownloadSink::SetFilename(const std::wstring& filename)
+{
+    // strip the compressed file's extension, if any
+    const size_t len = filename.length();
+    if ( len > 3 &&
+         filename[len - 3] == L'.' &&
+         towlower(filename[len - 2]) == L'g' &&
+         towlower(filename[len - 1]) == L'z' )
+    {
+        m_target.SetFilename(filename.substr(0, len - 3));
+    }
+    else
+    {
+        m_target.SetFilename(filename);
+    }
+}
+
+
+void DecompressingDownloadSink::Add(const void *data, size_t len)
+{
+    m_decoder.Decode(data, len, m_target);
+}
+
+
+void DecompressingDownloadSink::Finish()
+{
+    m_decoder.Finish(m_target);
+}
+
+} // namespace winsparkle
@@ -0,0 +1,200 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _decompress_h_
+#define _decompress_h_
+
+#include "download.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace winsparkle
+{
+
+/**
+    Streaming decoder of gzip-compressed data (RFC 1951 and 1952).
+
+    Compressed data can be fed to it in arbitrarily sized pieces; the
+    decompressed output is passed to a download sink as soon as it is
+    available. Multiple concatenated gzip members are supported, as is
+    zero padding after the last one.
+
+    Throws std::runtime_error on malformed input.
+
+    @note This code is platform-independent on purpose.
+ */
+class GzipDecoder
+{
+public:
+    GzipDecoder();
+
+    /**
+        Sets the expected size of decompressed data.
+
+        If set, larger output is rejected as soon as it is produced and
+        Finish() checks that the output has exactly this size. Otherwise,
+        the output may not be more than MAX_RATIO times larger than the
+        input (plus some slack for small files), to protect against
+        decompression bombs.
+     */
+    void SetExpectedSize(uint64_t size) { m_expectedSize = size; }
+
+    /// Largest accepted ratio of output and input size if the size is unknown.
+    enum { MAX_RATIO = 100 };
+
+    /// Decompresses the next piece of input, passing output to @a output.
+    void Decode(const void *data, size_t len, IDownloadSink& output);
+
+    /**
+        Checks that the input ended at the end of a gzip member.
+
+        Throws if the compressed data were truncated.
+     */
+    void Finish(IDownloadSink& output);
+
+private:
+    // Canonical Huffman code, see BuildHuffman()
+    struct Huffman
+    {
+        enum { FAST_BITS = 9 };
+        short count[16];          // number of codes of each length
+        short symbol[288];        // symbols ordered by their codes
+        uint16_t fast[1 << FAST_BITS]; // (len << 9) | symbol, for short codes
+    };
+
+    enum State
+    {
+        State_Header,             // fixed part of gzip member header
+        State_HeaderExtraLen,
+        State_HeaderExtra,
+        State_HeaderName,
+        State_HeaderComment,
+        State_HeaderCrc,
+        State_BlockHeader,
+        State_StoredLen,
+        State_Stored,
+        State_TableCounts,
+        State_CodeLengthCodes,
+        State_CodeLengths,
+        State_Codes,
+        State_Trailer,
+        State_Padding             // zero bytes after the last member
+    };
+
+    bool Step();
+    bool Need(unsigned n);
+    unsigned Bits(unsigned n);
+    bool GetByte(unsigned& byte);
+    int DecodeSymbol(const Huffman& h);
+    void BuildHuffman(Huffman& h, const uint16_t *lengths, unsigned n);
+    void BuildDynamicTables();
+    void PutByte(unsigned char b) { m_window[m_pos++ & WINDOW_MASK] = b; }
+    void FlushOutput();
+
+    enum { WINDOW_SIZE = 128 * 1024, WINDOW_MASK = WINDOW_SIZE - 1 };
+    enum { FLUSH_THRESHOLD = 32 * 1024 };
+
+    State m_state;
+
+    // current input and its unconsumed bits
+    const unsigned char *m_in, *m_inEnd;
+    uint64_t m_bits;
+    unsigned m_bitCount;
+
+    // header and trailer parsing
+    unsigned char m_header[10];
+    unsigned m_headerPos;
+    unsigned m_flags;
+    bool m_memberDone;
+
+    // block decoding
+    bool m_lastBlock;
+    size_t m_remaining;
+    unsigned m_numLen, m_numDist, m_numCodeLen, m_lengthIndex;
+    uint16_t m_lengths[320];
+    Huffman m_lenCode, m_distCode, m_codeLenCode;
+
+    // history of decompressed data and the part not yet passed on
+    std::vector<unsigned char> m_window;
+    uint64_t m_pos, m_flushed, m_memberStart;
+    IDownloadSink *m_output;
+
+    // limits of output size
+    uint64_t m_expectedSize, m_inputSize;
+
+    uint32_t m_crcTable[256];
+    uint32_t m_crc;
+};
+
+
+/**
+    IDownloadSink decorator that decompresses data before passing them
+    to another sink.
+ */
+class DecompressingDownloadSink : public IDownloadSink
+{
+public:
+    /**
+        Creates the decompressor.
+
+        Throws if @a compression is not supported.
+
+        @param target       Sink to pass decompressed data to.
+        @param compression  Name of compression format, as used in the
+                            appcast's sparkle:compression attribute.
+        @param size         Expected size of decompressed data or 0 if
+                            unknown, see GzipDecoder::SetExpectedSize().
+     */
+    DecompressingDownloadSink(IDownloadSink& target, const std::string& compression,
+                              uint64_t size = 0);
+
+    /// Returns true if @a compression is a supported compression format.
+    static bool IsSupported(const std::string& compression);
+
+    // size of decompressed data is unknown, don't pass it on
+    virtual void SetLength(size_t) {}
+
+    virtual void SetFilename(const std::wstring& filename);
+
+    virtual void Add(const void *data, size_t len);
+
+    /**
+        Completes decompression.
+
+        Must be called after all data were added. Throws if the compressed
+        data were incomplete.
+     */
+    void Finish();
+
+private:
+    IDownloadSink& m_target;
+    GzipDecoder m_decoder;
+};
+
+} // namespace winsparkle
+
+#endif // _decompress_h_
@@ -28,6 +28,7 @@
 #include "appcontroller.h"
 #include "settings.h"
 #include "error.h"
+#include "notifications.h"
 #include "ui.h"
 #include "updatechecker.h"
 #include "updatedownloader.h"
@@ -37,6 +38,22 @@
 
 using namespace winsparkle;
 
+namespace
+{
+
+// Set once win_sparkle_init() was called
+bool g_initialized = false;
+
+// Throws if a configuration function that must be called before
+// win_sparkle_init() is called too late
+void CheckNotInitialized(const char *func)
+{
+    if ( g_initialized )
+        throw std::runtime_error(std::string(func) + "() must be called before win_sparkle_init().");
+}
+
+} // anonymous namespace
+
 extern "C"
 {
 
@@ -48,6 +65,8 @@ WIN_SPARKLE_API void __cdecl win_sparkle_init()
 {
     try
     {
+        g_initialized = true;
+
         // finish initialization
         if (!Settings::GetLanguage().IsOk())
         {
@@ -105,8 +124,12 @@ WIN_SPARKLE_API void __cdecl win_sparkle_cleanup()
 {
     try
     {
+        g_initialized = false;
+
         UI::ShutDown();
 
+        NotificationListener::StopAll();
+
         // FIXME: shut down any worker UpdateChecker and UpdateDownloader threads too
     }
     CATCH_ALL_EXCEPTIONS
@@ -144,7 +167,7 @@ WIN_SPARKLE_API void __cdecl win_sparkle_set_appcast_url(const char *url)
 {
     try
     {
-        CheckForInsecureURL(url, "appcast feed");
+        CheckForInsecureURL(url, "appcast feed", url);
         Settings::SetAppcastURL(url);
     }
     CATCH_ALL_EXCEPTIONS
@@ -172,6 +195,18 @@ WIN_SPARKLE_API int __cdecl win_sparkle_set_eddsa_public_key(const char *pubkey)
     return 0;
 }
 
+WIN_SPARKLE_API int __cdecl win_sparkle_add_eddsa_public_key(const char *pubkey)
+{
+    try
+    {
+        CheckNotInitialized("win_sparkle_add_eddsa_public_key");
+        Settings::AddEdDSAPubKey(pubkey);
+        return 1;
+    }
+    CATCH_ALL_EXCEPTIONS
+    return 0;
+}
+
 WIN_SPARKLE_API void __cdecl win_sparkle_set_app_details(const wchar_t *company_name,
                                                          const wchar_t *app_name,
                                                          const wchar_t *app_version)
@@ -203,6 +238,26 @@ WIN_SPARKLE_API void __cdecl win_sparkle_clear_http_headers()
     CATCH_ALL_EXCEPTIONS
 }
 
+WIN_SPARKLE_API void __cdecl win_sparkle_set_download_timeouts(int connect_timeout,
+                                                               int first_byte_timeout,
+                                                               int inactivity_timeout)
+{
+    try
+    {
+        Settings::SetDownloadTimeouts(connect_timeout, first_byte_timeout, inactivity_timeout);
+    }
+    CATCH_ALL_EXCEPTIONS
+}
+
+WIN_SPARKLE_API void __cdecl win_sparkle_set_download_min_speed(int min_bytes_per_sec, int period)
+{
+    try
+    {
+        Settings::SetDownloadMinSpeed(min_bytes_per_sec, period);
+    }
+    CATCH_ALL_EXCEPTIONS
+}
+
 WIN_SPARKLE_API void __cdecl win_sparkle_set_app_build_version(const wchar_t *build)
 {
     try
@@ -230,6 +285,15 @@ WIN_SPARKLE_API void __cdecl win_sparkle_set_config_methods(win_sparkle_config_m
     CATCH_ALL_EXCEPTIONS
 }
 
+WIN_SPARKLE_API void __cdecl win_sparkle_set_appcast_cache(int enabled)
+{
+    try
+    {
+        Settings::SetAppcastCacheEnabled(enabled != 0);
+    }
+    CATCH_ALL_EXCEPTIONS
+}
+
 WIN_SPARKLE_API void __cdecl win_sparkle_set_automatic_check_for_updates(int state)
 {
     try
@@ -284,6 +348,15 @@ WIN_SPARKLE_API int __cdecl win_sparkle_get_update_check_interval()
     return DEFAULT_CHECK_INTERVAL;
 }
 
+WIN_SPARKLE_API void __cdecl win_sparkle_set_adaptive_update_check(int max_interval)
+{
+    try
+    {
+        Settings::SetAdaptiveCheckMaxInterval(max_interval > 0 ? max_interval : 0);
+    }
+    CATCH_ALL_EXCEPTIONS
+}
+
 WIN_SPARKLE_API time_t __cdecl win_sparkle_get_last_check_time()
 {
     static const time_t DEFAULT_LAST_CHECK_TIME = -1;
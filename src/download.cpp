@@ -30,9 +30,11 @@
 #include "utils.h"
 #include "winsparkle-version.h"
 
+#include <algorithm>
 #include <string>
 #include <windows.h>
 #include <wininet.h>
+#include <shlwapi.h>
 
 #ifndef INTERNET_OPTION_ENABLE_HTTP_PROTOCOL
     #define INTERNET_OPTION_ENABLE_HTTP_PROTOCOL 148
@@ -173,14 +175,199 @@ void CALLBACK DownloadInternetStatusCallback(_In_ HINTERNET hInternet,
     }
 }
 
-void WaitUntilSignaledWithTerminationCheck(Event& event, Thread *thread)
+// Converts timeout in seconds, as stored in settings, to milliseconds
+DWORD TimeoutToMs(int seconds)
 {
+    return seconds > 0 ? DWORD(seconds) * 1000 : INFINITE;
+}
+
+// Timeout of streaming connections: servers are expected to send keep-alive
+// comments more often than this, so a stream that is quiet for longer is
+// most likely dead (e.g. dropped by a NAT or proxy without closing it).
+const int STREAMING_TIMEOUT = 5 * 60;
+
+// Aborts transfers that are slower than required for too long.
+class ThroughputWatchdog
+{
+public:
+    ThroughputWatchdog(const Settings::NetworkLimits& limits)
+        : m_minSpeed(limits.minSpeed > 0 ? limits.minSpeed : 0),
+          m_period(limits.minSpeedPeriod > 0 ? TimeoutToMs(limits.minSpeedPeriod) : 0),
+          m_start(GetTickCount()), m_bytes(0)
+    {}
+
+    // Call periodically with number of bytes received since the last call.
+    void Update(size_t bytes)
+    {
+        if ( !m_minSpeed || !m_period )
+            return;
+
+        m_bytes += bytes;
+
+        const DWORD elapsed = GetTickCount() - m_start;
+        if ( elapsed < m_period )
+            return;
+
+        if ( m_bytes * 1000 < ULONGLONG(m_minSpeed) * elapsed )
+            throw std::runtime_error("Download is too slow.");
+
+        m_start += elapsed;
+        m_bytes = 0;
+    }
+
+private:
+    DWORD m_minSpeed, m_period;
+    DWORD m_start;
+    ULONGLONG m_bytes;
+};
+
+void WaitUntilSignaledWithTerminationCheck(Event& event, Thread *thread,
+                                           DWORD timeout = INFINITE,
+                                           ThroughputWatchdog *watchdog = NULL)
+{
+    const DWORD start = GetTickCount();
     for (;;)
     {
         if (thread)
             thread->CheckShouldTerminate();
         if (event.WaitUntilSignaled(100))
             return;
+        if (timeout != INFINITE && GetTickCount() - start >= timeout)
+            throw std::runtime_error("Connection timed out.");
+        if (watchdog)
+            watchdog->Update(0);
+    }
+}
+
+
+/*--------------------------------------------------------------------------*
+                               local files
+ *--------------------------------------------------------------------------*/
+
+// Size of mapped views of local files and of pieces passed to the sink
+const size_t LOCAL_FILE_VIEW_SIZE = 16 * 1024 * 1024;
+const size_t LOCAL_FILE_CHUNK_SIZE = 1024 * 1024;
+
+struct FileHandle
+{
+    FileHandle(HANDLE handle) : m_handle(handle) {}
+
+    ~FileHandle()
+    {
+        if ( m_handle && m_handle != INVALID_HANDLE_VALUE )
+            CloseHandle(m_handle);
+    }
+
+    operator HANDLE() const { return m_handle; }
+
+    HANDLE m_handle;
+};
+
+bool IsNetworkPath(const std::wstring& path)
+{
+    if ( PathIsUNCW(path.c_str()) )
+        return true;
+
+    if ( path.length() < 2 || path[1] != L':' )
+        return false;
+    const wchar_t root[] = { path[0], L':', L'\\', 0 };
+    return GetDriveTypeW(root) == DRIVE_REMOTE;
+}
+
+// Passes content of a local file, starting at given offset, to the sink.
+void ReadLocalFile(const std::wstring& path, IDownloadSink *sink, Thread *onThread, ULONGLONG offset)
+{
+    FileHandle file(CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                                OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+    if ( file == INVALID_HANDLE_VALUE )
+        throw Win32Exception(("Cannot open " + WideToAnsi(path)).c_str());
+
+    LARGE_INTEGER size;
+    if ( !GetFileSizeEx(file, &size) )
+        throw Win32Exception();
+
+    if ( offset )
+    {
+        LARGE_INTEGER pos;
+        pos.QuadPart = offset;
+        if ( !SetFilePointerEx(file, pos, NULL, FILE_BEGIN) )
+            throw Win32Exception(("Cannot read " + WideToAnsi(path)).c_str());
+    }
+    else
+    {
+        sink->SetLength(size_t(size.QuadPart));
+        sink->SetFilename(PathFindFileNameW(path.c_str()));
+    }
+
+    if ( ULONGLONG(size.QuadPart) <= offset )
+        return;
+
+    if ( offset || IsNetworkPath(path) )
+    {
+        // Don't memory-map files on network shares: if the connection failed,
+        // accessing the memory would crash instead of reporting an error.
+        // Read them normally, directly into sink's memory if possible.
+        DataBuffer<char> buffer(LOCAL_FILE_CHUNK_SIZE);
+        for ( ;; )
+        {
+            if ( onThread )
+                onThread->CheckShouldTerminate();
+
+            size_t bufferLen = 0;
+            void *lent = sink->AcquireBuffer(LOCAL_FILE_CHUNK_SIZE, bufferLen);
+
+            DWORD read = 0;
+            const BOOL ok = ReadFile(file,
+                                     lent ? lent : buffer.data,
+                                     lent ? (DWORD)bufferLen : (DWORD)LOCAL_FILE_CHUNK_SIZE,
+                                     &read, NULL);
+            if ( lent )
+                sink->CommitBuffer(read);
+            else if ( read )
+                sink->Add(buffer, read);
+
+            if ( !ok )
+                throw Win32Exception(("Cannot read " + WideToAnsi(path)).c_str());
+            if ( read == 0 )
+                return;
+        }
+    }
+
+    FileHandle mapping(CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL));
+    if ( !mapping )
+        throw Win32Exception();
+
+    for ( ULONGLONG viewOffset = 0; viewOffset < ULONGLONG(size.QuadPart); viewOffset += LOCAL_FILE_VIEW_SIZE )
+    {
+        ULONGLONG viewSize = ULONGLONG(size.QuadPart) - viewOffset;
+        if ( viewSize > LOCAL_FILE_VIEW_SIZE )
+            viewSize = LOCAL_FILE_VIEW_SIZE;
+
+        const char *view = static_cast<const char*>(
+            MapViewOfFile(mapping, FILE_MAP_READ, DWORD(viewOffset >> 32), DWORD(viewOffset), size_t(viewSize)));
+        if ( !view )
+            throw Win32Exception();
+
+        try
+        {
+            for ( size_t pos = 0; pos < viewSize; pos += LOCAL_FILE_CHUNK_SIZE )
+            {
+                if ( onThread )
+                    onThread->CheckShouldTerminate();
+
+                size_t len = size_t(viewSize) - pos;
+                if ( len > LOCAL_FILE_CHUNK_SIZE )
+                    len = LOCAL_FILE_CHUNK_SIZE;
+                sink->Add(view + pos, len);
+            }
+        }
+        catch ( ... )
+        {
+            UnmapViewOfFile(view);
+            throw;
+        }
+
+        UnmapViewOfFile(view);
     }
 }
 
@@ -191,8 +378,44 @@ void WaitUntilSignaledWithTerminationCheck(Event& event, Thread *thread)
                                 public functions
  *--------------------------------------------------------------------------*/
 
-void DownloadFile(const std::string& url, IDownloadSink* sink, Thread* onThread, const std::string& headers_, int flags)
+std::wstring GetLocalPathFromURL(const std::string& url)
 {
+    // URLs are in UTF-8, unlike most of the strings we deal with
+    std::wstring wurl;
+    const int wlen = MultiByteToWideChar(CP_UTF8, 0, url.c_str(), -1, NULL, 0);
+    if ( wlen > 0 )
+    {
+        DataBuffer<wchar_t> buf(wlen);
+        MultiByteToWideChar(CP_UTF8, 0, url.c_str(), -1, buf, wlen);
+        wurl = buf.data;
+    }
+
+    // plain UNC path
+    if ( wurl.compare(0, 2, L"\\\\") == 0 )
+        return wurl;
+
+    if ( _wcsnicmp(wurl.c_str(), L"file:", 5) != 0 )
+        return std::wstring();
+
+    // handles both file:///C:/path and file://server/share/path forms
+    wchar_t path[2048];
+    DWORD pathLen = sizeof(path) / sizeof(path[0]);
+    if ( FAILED(PathCreateFromUrlW(wurl.c_str(), path, &pathLen, 0)) )
+        throw std::runtime_error("Invalid file URL: " + url);
+
+    return path;
+}
+
+
+void DownloadFile(const std::string& url, IDownloadSink* sink, Thread* onThread, const std::string& headers_, int flags, size_t resumeFrom)
+{
+    const std::wstring localPath = GetLocalPathFromURL(url);
+    if ( !localPath.empty() )
+    {
+        ReadLocalFile(localPath, sink, onThread, resumeFrom);
+        return;
+    }
+
     std::string headers = headers_;
     char url_path[2048];
     URL_COMPONENTSA urlc;
@@ -218,7 +441,26 @@ void DownloadFile(const std::string& url, IDownloadSink* sink, Thread* onThread,
     DWORD dwOption = HTTP_PROTOCOL_FLAG_HTTP2;
     InternetSetOptionW(inet, INTERNET_OPTION_ENABLE_HTTP_PROTOCOL, &dwOption, sizeof(dwOption));
 
-    if (IsWindowsVistaOrGreater())
+    Settings::NetworkLimits limits = Settings::GetNetworkLimits();
+    if ( flags & Download_Streaming )
+    {
+        limits.firstByteTimeout = STREAMING_TIMEOUT;
+        limits.inactivityTimeout = STREAMING_TIMEOUT;
+        limits.minSpeed = 0;
+    }
+    if ( limits.connectTimeout > 0 )
+    {
+        DWORD dwTimeout = TimeoutToMs(limits.connectTimeout);
+        InternetSetOptionW(inet, INTERNET_OPTION_CONNECT_TIMEOUT, &dwTimeout, sizeof(dwTimeout));
+    }
+
+    // Ranges are of the encoded content, so don't use compression when resuming.
+    // Streams aren't compressed either, because decoding would delay the data.
+    if ( resumeFrom )
+    {
+        headers += "Range: bytes=" + std::to_string((unsigned long long)resumeFrom) + "-\r\n";
+    }
+    else if ( !(flags & Download_Streaming) && IsWindowsVistaOrGreater() )
     {
         DWORD dwEnableHttpDecoding = TRUE;
         InternetSetOptionW(inet, INTERNET_OPTION_HTTP_DECODING, &dwEnableHttpDecoding, sizeof(dwEnableHttpDecoding));
@@ -263,26 +505,45 @@ void DownloadFile(const std::string& url, IDownloadSink* sink, Thread* onThread,
             throw Win32Exception();
     }
 
-    WaitUntilSignaledWithTerminationCheck(context.eventRequestComplete, onThread);
+    WaitUntilSignaledWithTerminationCheck(context.eventRequestComplete, onThread,
+                                          TimeoutToMs(limits.firstByteTimeout));
 
     // Check returned status code - we need to detect 404 instead of
     // downloading the human-readable 404 page:
-    DWORD statusCode;
-    if ( GetHttpHeader(conn, HTTP_QUERY_STATUS_CODE, statusCode) && statusCode >= 400 )
+    DWORD statusCode = 0;
+    GetHttpHeader(conn, HTTP_QUERY_STATUS_CODE, statusCode);
+    if ( statusCode >= 400 )
     {
         throw std::runtime_error("Update file not found on the server.");
     }
 
+    // Conditional requests may find the data unchanged:
+    if ( statusCode == 304 )
+    {
+        sink->SetNotModified();
+        return;
+    }
+
+    char etag[256];
+    DWORD etagSize = sizeof(etag);
+    if ( HttpQueryInfoA(conn, HTTP_QUERY_ETAG, etag, &etagSize, NULL) )
+        sink->SetETag(std::string(etag, etagSize));
+
+    // When resuming, the sink already knows the length and filename. If the
+    // server ignored the range request, skip the data we already have.
+    size_t skip = (resumeFrom && statusCode != 206) ? resumeFrom : 0;
+
     // Get content length if possible:
     DWORD contentLength;
-    if ( GetHttpHeader(conn, HTTP_QUERY_CONTENT_LENGTH, contentLength) )
+    if ( !resumeFrom && GetHttpHeader(conn, HTTP_QUERY_CONTENT_LENGTH, contentLength) )
         sink->SetLength(contentLength);
 
     // Get filename fron Content-Disposition, if available
     char contentDisposition[512];
     DWORD cdSize = 512;
-    bool filename_set = false;
-    if ( HttpQueryInfoA(conn, HTTP_QUERY_CONTENT_DISPOSITION, contentDisposition, &cdSize, NULL) )
+    bool filename_set = resumeFrom != 0;
+    if ( !filename_set &&
+         HttpQueryInfoA(conn, HTTP_QUERY_CONTENT_DISPOSITION, contentDisposition, &cdSize, NULL) )
     {
         char *ptr = strstr(contentDisposition, "filename=");
         if ( ptr )
@@ -331,33 +592,77 @@ void DownloadFile(const std::string& url, IDownloadSink* sink, Thread* onThread,
         }
     }
 
-    // Download the data:
+    // Download the data. If the sink supports it, read directly into its
+    // memory; otherwise use our own buffer and pass the data to Add():
     char buffer[10240];
+    ThroughputWatchdog watchdog(limits);
     for ( ;; )
     {
+        size_t bufferLen = 0;
+        void *lent = skip ? NULL : sink->AcquireBuffer(sizeof(buffer), bufferLen);
+
         INTERNET_BUFFERS ibuf = { 0 };
         ibuf.dwStructSize = sizeof(ibuf);
-        ibuf.lpvBuffer = buffer;
-        ibuf.dwBufferLength = sizeof(buffer);
 
-        if (!InternetReadFileEx(conn, &ibuf, IRF_ASYNC | IRF_NO_WAIT, NULL))
+        // Note that with IRF_NO_WAIT, nothing is written into the buffer
+        // asynchronously: ERROR_IO_PENDING only means that no data is
+        // available yet and we should try again once it is.
+        try
         {
-            if (GetLastError() != ERROR_IO_PENDING)
-                throw Win32Exception();
+            for ( ;; )
+            {
+                ibuf.lpvBuffer = lent ? lent : buffer;
+                ibuf.dwBufferLength = lent ? (DWORD)bufferLen : (DWORD)sizeof(buffer);
+
+                if (InternetReadFileEx(conn, &ibuf, IRF_ASYNC | IRF_NO_WAIT, NULL))
+                    break;
 
-            WaitUntilSignaledWithTerminationCheck(context.eventRequestComplete, onThread);
-            continue;
+                if (GetLastError() != ERROR_IO_PENDING)
+                    throw Win32Exception();
+
+                WaitUntilSignaledWithTerminationCheck(context.eventRequestComplete, onThread,
+                                                      TimeoutToMs(limits.inactivityTimeout), &watchdog);
+            }
+        }
+        catch (...)
+        {
+            // every acquired buffer must be committed, even if empty
+            if (lent)
+                sink->CommitBuffer(0);
+            throw;
         }
 
+        // commit the buffer before anything else can throw
+        if (lent)
+        {
+            sink->CommitBuffer(ibuf.dwBufferLength);
+        }
+        else if (ibuf.dwBufferLength != 0)
+        {
+            const char *data = buffer;
+            size_t len = ibuf.dwBufferLength;
+            if (skip)
+            {
+                const size_t skipped = (std::min)(skip, len);
+                skip -= skipped;
+                data += skipped;
+                len -= skipped;
+            }
+            if (len)
+                sink->Add(data, len);
+        }
+
+        watchdog.Update(ibuf.dwBufferLength);
+
         if (ibuf.dwBufferLength == 0)
         {
             if (context.lastError != ERROR_SUCCESS)
                 throw Win32Exception();
+            else if (skip)
+                throw std::runtime_error("Downloaded file is shorter than expected.");
             else
                 break; // all of the file was downloaded
         }
-
-        sink->Add(ibuf.lpvBuffer, ibuf.dwBufferLength);
     }
 }
 
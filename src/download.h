@@ -26,6 +26,7 @@
 #ifndef _download_h_
 #define _download_h_
 
+#include <stdexcept>
 #include <string>
 
 namespace winsparkle
@@ -33,6 +34,30 @@ namespace winsparkle
 
 class Thread;
 
+/**
+    Thrown by download sinks that found the received data to be damaged,
+    e.g. by comparing them with known digests.
+
+    Unlike other errors thrown by sinks, this one can be recovered from by
+    downloading the data again, starting from the offset of the first
+    damaged byte.
+
+    @see DownloadFileWithFailover()
+ */
+class CorruptedDataException : public std::runtime_error
+{
+public:
+    CorruptedDataException(const std::string& msg, size_t validLength)
+        : std::runtime_error(msg), m_validLength(validLength)
+    {}
+
+    /// Length of the data before the damaged part, which were accepted.
+    size_t GetValidLength() const { return m_validLength; }
+
+private:
+    size_t m_validLength;
+};
+
 /**
     Abstraction for storing downloaded data.
  */
@@ -52,6 +77,41 @@ struct IDownloadSink
 
     /// Add chunk of downloaded data
     virtual void Add(const void *data, size_t len) = 0;
+
+    /**
+        Lend sink-owned memory for the downloader to write data into directly.
+
+        This is an optional extension that avoids copying the data through
+        an intermediate buffer and Add(). Sinks that don't support it return
+        NULL (the default), in which case Add() is used.
+
+        @param minLen  Minimal size of the buffer the caller needs.
+        @param len     Actual size of the returned buffer, which is at least
+                       @a minLen.
+
+        @return Pointer to the buffer or NULL. Every non-NULL return must be
+                followed by a call to CommitBuffer() before any other sink
+                method is called.
+     */
+    virtual void *AcquireBuffer(size_t /*minLen*/, size_t& /*len*/) { return NULL; }
+
+    /**
+        Finish writing into a buffer returned by AcquireBuffer().
+
+        @param len  Number of bytes actually written into the buffer; may be 0.
+     */
+    virtual void CommitBuffer(size_t /*len*/) {}
+
+    /// Inform the sink of the entity tag (ETag header) of the data, if any.
+    virtual void SetETag(const std::string& /*etag*/) {}
+
+    /**
+        Inform the sink that the server responded 304 Not Modified to
+        a conditional request (one with If-None-Match header).
+
+        No other sink methods are called in this case.
+     */
+    virtual void SetNotModified() {}
 };
 
 /**
@@ -59,7 +119,14 @@ struct IDownloadSink
  */
 struct StringDownloadSink : public IDownloadSink
 {
-    virtual void SetLength(size_t) {}
+    StringDownloadSink() : notModified(false), m_acquiredAt(0) {}
+
+    virtual void SetLength(size_t len)
+    {
+        // don't trust the server with unreasonably large allocations
+        if ( len <= 16 * 1024 * 1024 )
+            data.reserve(len);
+    }
 
     virtual void SetFilename(const std::wstring&) {}
 
@@ -68,8 +135,37 @@ struct StringDownloadSink : public IDownloadSink
         this->data.append(reinterpret_cast<const char*>(data), len);
     }
 
+    virtual void *AcquireBuffer(size_t minLen, size_t& len)
+    {
+        // lend all of the already reserved space if there's enough of it
+        m_acquiredAt = data.size();
+        len = data.capacity() - m_acquiredAt;
+        if ( len < minLen )
+            len = minLen;
+        data.resize(m_acquiredAt + len);
+        return &data[m_acquiredAt];
+    }
+
+    virtual void CommitBuffer(size_t len)
+    {
+        data.resize(m_acquiredAt + len);
+    }
+
+    virtual void SetETag(const std::string& etag) { this->etag = etag; }
+
+    virtual void SetNotModified() { notModified = true; }
+
     /// Downloaded data, as a string.
     std::string data;
+
+    /// Entity tag of the data, if the server sent one.
+    std::string etag;
+
+    /// True if the server responded that the data didn't change.
+    bool notModified;
+
+private:
+    size_t m_acquiredAt;
 };
 
 
@@ -77,22 +173,39 @@ struct StringDownloadSink : public IDownloadSink
 enum DownloadFlag
 {
     /// Instruct proxies to pass the request upstream
-    Download_BypassProxies = 1
+    Download_BypassProxies = 1,
+
+    /// Long-lived streaming connection: use long response and inactivity
+    /// timeouts, no minimum speed and no compression
+    Download_Streaming = 2
 };
 
+/**
+    Returns local filesystem path for a file:// URL or UNC path.
+
+    Returns empty string if @a url is not local. Throws if it is malformed.
+ */
+std::wstring GetLocalPathFromURL(const std::string& url);
+
 /**
     Downloads a HTTP resource.
 
+    Local files (file:// URLs or UNC paths) are supported too.
+
     Throws on error.
 
     @param url       URL of the resource to download.
     @param sink      Where to put downloaded data.
     @param onThread  Thread the request runs on.
     @param flags     Or-combination of DownloadFlag values.
+    @param resumeFrom  Offset to continue an interrupted download from. If
+                       nonzero, only data from this offset on are passed
+                       to the sink and its SetLength() and SetFilename()
+                       are not called.
 
     @see CheckConnection()
  */
-void DownloadFile(const std::string& url, IDownloadSink *sink, Thread *onThread, const std::string &headers = "", int flags = 0);
+void DownloadFile(const std::string& url, IDownloadSink *sink, Thread *onThread, const std::string &headers = "", int flags = 0, size_t resumeFrom = 0);
 
 } // namespace winsparkle
 
@@ -0,0 +1,97 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "eventstream.h"
+
+#include <cstdlib>
+#include <stdexcept>
+
+namespace winsparkle
+{
+
+void EventStreamParser::Add(const void *data, size_t len)
+{
+    const char *p = static_cast<const char*>(data);
+    for ( const char *end = p + len; p != end; ++p )
+    {
+        // lines may end with CR, LF or CRLF
+        if ( *p == '\n' && m_afterCR )
+        {
+            m_afterCR = false;
+            continue;
+        }
+        m_afterCR = (*p == '\r');
+
+        if ( *p == '\r' || *p == '\n' )
+        {
+            ProcessLine();
+            m_line.clear();
+        }
+        else
+        {
+            if ( m_line.length() >= MAX_LINE_LENGTH )
+                throw std::runtime_error("Invalid notifications stream.");
+            m_line += *p;
+        }
+    }
+}
+
+
+void EventStreamParser::ProcessLine()
+{
+    if ( m_line.empty() )
+    {
+        // blank line dispatches the event, if it had any data
+        if ( m_hasData )
+            m_handler.OnNotification();
+        m_hasData = false;
+        return;
+    }
+
+    if ( m_line[0] == ':' )
+        return; // comment, used as keep-alive
+
+    const size_t colon = m_line.find(':');
+    const std::string field = m_line.substr(0, colon);
+    std::string value;
+    if ( colon != std::string::npos )
+    {
+        value = m_line.substr(colon + 1);
+        if ( !value.empty() && value[0] == ' ' )
+            value.erase(0, 1);
+    }
+
+    if ( field == "data" )
+    {
+        m_hasData = true;
+    }
+    else if ( field == "retry" )
+    {
+        if ( !value.empty() && value.find_first_not_of("0123456789") == std::string::npos )
+            m_handler.OnRetryDelay(unsigned(strtoul(value.c_str(), NULL, 10)));
+    }
+}
+
+} // namespace winsparkle
@@ -0,0 +1,85 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _eventstream_h_
+#define _eventstream_h_
+
+#include "download.h"
+
+#include <string>
+
+namespace winsparkle
+{
+
+/// Receives events found by EventStreamParser.
+struct IEventStreamHandler
+{
+    /// Called once the server responded, i.e. the stream is open.
+    virtual void OnConnected() = 0;
+
+    /// Called for every event that carried data.
+    virtual void OnNotification() = 0;
+
+    /// Called when the server requests a different reconnection delay.
+    virtual void OnRetryDelay(unsigned delayMilliseconds) = 0;
+
+    virtual ~IEventStreamHandler() {}
+};
+
+/**
+    Parses text/event-stream data.
+
+    Only the parts needed for notifications are implemented: event
+    boundaries and the "retry" field. Event types and data are ignored,
+    any event is treated as a release announcement.
+
+    Throws if the stream contains a line longer than MAX_LINE_LENGTH.
+ */
+class EventStreamParser : public IDownloadSink
+{
+public:
+    /// Longest line accepted from the server
+    static const size_t MAX_LINE_LENGTH = 4096;
+
+    EventStreamParser(IEventStreamHandler& handler)
+        : m_handler(handler), m_hasData(false), m_afterCR(false)
+    {}
+
+    virtual void SetLength(size_t) {}
+    virtual void SetFilename(const std::wstring&) { m_handler.OnConnected(); }
+    virtual void Add(const void *data, size_t len);
+
+private:
+    void ProcessLine();
+
+    IEventStreamHandler& m_handler;
+    std::string m_line;
+    bool m_hasData;
+    bool m_afterCR;
+};
+
+} // namespace winsparkle
+
+#endif // _eventstream_h_
@@ -0,0 +1,723 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "feedcache.h"
+#include "feedstate.h"
+#include "download.h"
+#include "error.h"
+#include "settings.h"
+#include "threads.h"
+#include "updatechecker.h"
+#include "winsparkle-version.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include <windows.h>
+
+namespace winsparkle
+{
+
+/*--------------------------------------------------------------------------*
+                                 helpers
+ *--------------------------------------------------------------------------*/
+
+namespace
+{
+
+// Cache files are small; anything larger is corrupted
+const LONGLONG MAX_CACHE_FILE_SIZE = 16 * 1024 * 1024;
+
+// Guards access to cache files
+CriticalSection g_csCacheFiles;
+
+void CreateDirectoryIfNeeded(const std::wstring& dir, bool create)
+{
+    if ( create && !CreateDirectoryW(dir.c_str(), NULL) && GetLastError() != ERROR_ALREADY_EXISTS )
+        throw Win32Exception("Cannot create cache directory");
+}
+
+std::wstring GetCacheDirectory(bool create)
+{
+    wchar_t appdata[MAX_PATH];
+    const DWORD len = GetEnvironmentVariableW(L"LOCALAPPDATA", appdata, MAX_PATH);
+    if ( !len || len >= MAX_PATH )
+        throw std::runtime_error("Cannot find local application data directory.");
+
+    std::wstring dir(appdata);
+
+    const std::wstring vendor = Settings::GetCompanyName();
+    if ( !vendor.empty() )
+    {
+        dir += L"\\" + vendor;
+        CreateDirectoryIfNeeded(dir, create);
+    }
+    dir += L"\\" + Settings::GetAppName();
+    CreateDirectoryIfNeeded(dir, create);
+    dir += L"\\WinSparkle";
+    CreateDirectoryIfNeeded(dir, create);
+
+    return dir;
+}
+
+bool ReadFileContents(const std::wstring& path, std::string& data)
+{
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if ( file == INVALID_HANDLE_VALUE )
+        return false;
+
+    bool ok = false;
+    LARGE_INTEGER size;
+    if ( GetFileSizeEx(file, &size) && size.QuadPart < MAX_CACHE_FILE_SIZE )
+    {
+        data.resize(size_t(size.QuadPart));
+        DWORD read = 0;
+        ok = data.empty() ||
+             (ReadFile(file, &data[0], DWORD(data.size()), &read, NULL) && read == data.size());
+    }
+
+    CloseHandle(file);
+    return ok;
+}
+
+// Writes the file atomically, so that it's never seen half-written.
+void WriteFileContents(const std::wstring& path, const std::string& data)
+{
+    const std::wstring tmp = path + L".tmp";
+
+    HANDLE file = CreateFileW(tmp.c_str(), GENERIC_WRITE, 0, NULL,
+                              CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if ( file == INVALID_HANDLE_VALUE )
+        throw Win32Exception("Cannot write cache file");
+
+    DWORD written = 0;
+    const bool ok = WriteFile(file, data.data(), DWORD(data.size()), &written, NULL) &&
+                    written == data.size();
+    CloseHandle(file);
+
+    if ( !ok || !MoveFileExW(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) )
+    {
+        DeleteFileW(tmp.c_str());
+        throw Win32Exception("Cannot write cache file");
+    }
+}
+
+// State of an append-only feed after the last check, stored in a file
+struct FeedCache : public FeedState
+{
+    static std::wstring GetPath(bool create)
+    {
+        return GetCacheDirectory(create) + L"\\appcast.cache";
+    }
+
+    bool Load()
+    {
+        CriticalSectionLocker lock(g_csCacheFiles);
+
+        std::string data;
+        return ReadFileContents(GetPath(false), data) && Deserialize(data);
+    }
+
+    void Save() const
+    {
+        CriticalSectionLocker lock(g_csCacheFiles);
+
+        WriteFileContents(GetPath(true), Serialize());
+    }
+
+    static void Delete()
+    {
+        CriticalSectionLocker lock(g_csCacheFiles);
+        DeleteFileW(GetPath(false).c_str());
+    }
+};
+
+
+/*--------------------------------------------------------------------------*
+                             appcast snapshots
+ *--------------------------------------------------------------------------*/
+
+// Snapshot files start with this, followed by format version, payload size
+// and its checksum. The payload starts with the version of WinSparkle that
+// parsed the items, because newer versions may parse them differently.
+const char SNAPSHOT_MAGIC[4] = { 'W', 'S', 'A', 'S' };
+const uint32_t SNAPSHOT_VERSION = 8;
+
+struct SnapshotHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t size;
+    uint64_t checksum;
+};
+
+// FNV-1a, good enough to detect corrupted files
+uint64_t SnapshotChecksum(const char *data, size_t len)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for ( size_t i = 0; i < len; i++ )
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Identifies the system, because which items are usable depends on it.
+std::string GetSystemKey()
+{
+    typedef LONG (WINAPI *RtlGetVersion_t)(OSVERSIONINFOEXW*);
+
+    OSVERSIONINFOEXW osvi = {};
+    osvi.dwOSVersionInfoSize = sizeof(osvi);
+    HMODULE ntdll = GetModuleHandleW(L"ntdll.dll");
+    RtlGetVersion_t rtlGetVersion =
+        ntdll ? reinterpret_cast<RtlGetVersion_t>(GetProcAddress(ntdll, "RtlGetVersion")) : NULL;
+    if ( rtlGetVersion )
+        rtlGetVersion(&osvi);
+
+    std::ostringstream s;
+    s << osvi.dwMajorVersion << '.' << osvi.dwMinorVersion << '.' << osvi.dwBuildNumber
+      << '.' << osvi.wServicePackMajor
+#if defined(__AARCH64EL__) || defined(_M_ARM64)
+      << " arm64";
+#elif defined(_WIN64)
+      << " x64";
+#else
+      << " x86";
+#endif
+    return s.str();
+}
+
+class SnapshotWriter
+{
+public:
+    void WriteNumber(uint64_t value) { m_data.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+    void WriteBool(bool value) { m_data += char(value ? 1 : 0); }
+    void WriteString(const std::string& s) { WriteNumber(s.size()); m_data += s; }
+
+    const std::string& GetData() const { return m_data; }
+
+private:
+    std::string m_data;
+};
+
+class SnapshotReader
+{
+public:
+    SnapshotReader(const char *data, size_t len) : m_data(data), m_end(data + len) {}
+
+    uint64_t ReadNumber()
+    {
+        uint64_t value;
+        memcpy(&value, Read(sizeof(value)), sizeof(value));
+        return value;
+    }
+
+    bool ReadBool() { return *Read(1) != 0; }
+
+    std::string ReadString()
+    {
+        const uint64_t len = ReadNumber();
+        if ( len > uint64_t(m_end - m_data) )
+            ThrowCorrupted();
+        return std::string(Read(size_t(len)), size_t(len));
+    }
+
+    bool AtEnd() const { return m_data == m_end; }
+
+private:
+    const char *Read(size_t len)
+    {
+        if ( len > size_t(m_end - m_data) )
+            ThrowCorrupted();
+        const char *p = m_data;
+        m_data += len;
+        return p;
+    }
+
+    static void ThrowCorrupted() { throw std::runtime_error("Corrupted appcast snapshot."); }
+
+    const char *m_data;
+    const char *m_end;
+};
+
+// Texts are stored undecoded, if they weren't decoded yet.
+void WriteText(SnapshotWriter& w, const AppcastText& text)
+{
+    std::string xml;
+    size_t prologLength;
+    const bool raw = text.GetSource(xml, prologLength);
+    w.WriteBool(raw);
+    if ( raw )
+    {
+        w.WriteNumber(prologLength);
+        w.WriteString(xml);
+    }
+    else
+    {
+        w.WriteString(text.Get());
+    }
+}
+
+void ReadText(SnapshotReader& r, AppcastText& text)
+{
+    if ( r.ReadBool() )
+    {
+        const uint64_t prologLength = r.ReadNumber();
+        std::shared_ptr<const std::string> xml = std::make_shared<const std::string>(r.ReadString());
+        if ( prologLength > xml->size() )
+            throw std::runtime_error("Corrupted appcast snapshot.");
+        text.SetSource(xml, size_t(prologLength), size_t(prologLength), xml->size());
+    }
+    else
+    {
+        text = r.ReadString();
+    }
+}
+
+void WriteAppcast(SnapshotWriter& w, const Appcast& item)
+{
+    w.WriteString(item.Version);
+    w.WriteString(item.ShortVersionString);
+    w.WriteString(item.ReleaseNotesURL);
+    w.WriteString(item.WebBrowserURL);
+    WriteText(w, item.Title);
+    WriteText(w, item.Description);
+    w.WriteString(item.MinOSVersion);
+    w.WriteBool(item.CriticalUpdate);
+    w.WriteNumber(item.SourceBegin);
+    w.WriteNumber(item.SourceEnd);
+
+    const Appcast::Enclosure& enclosure = item.enclosure;
+    w.WriteString(enclosure.DownloadURL);
+    w.WriteNumber(enclosure.MirrorURLs.size());
+    for ( const std::string& mirror : enclosure.MirrorURLs )
+        w.WriteString(mirror);
+    w.WriteString(enclosure.DsaSignature);
+    w.WriteString(enclosure.EdDsaSignature);
+    w.WriteString(enclosure.EdDsaTreeSignature);
+    w.WriteString(enclosure.EdKeyId);
+    w.WriteString(enclosure.OS);
+    w.WriteString(enclosure.InstallerArguments);
+    w.WriteString(enclosure.Compression);
+    w.WriteBool(enclosure.SignatureOfCompressedData);
+    w.WriteNumber(enclosure.DecompressedLength);
+    w.WriteNumber(enclosure.Length);
+    w.WriteString(enclosure.Sha256);
+    w.WriteString(enclosure.ChunkManifestURL);
+    w.WriteString(enclosure.ChunkManifestSignature);
+}
+
+Appcast ReadAppcast(SnapshotReader& r)
+{
+    Appcast item;
+    item.Version = r.ReadString();
+    item.ShortVersionString = r.ReadString();
+    item.ReleaseNotesURL = r.ReadString();
+    item.WebBrowserURL = r.ReadString();
+    ReadText(r, item.Title);
+    ReadText(r, item.Description);
+    item.MinOSVersion = r.ReadString();
+    item.CriticalUpdate = r.ReadBool();
+    item.SourceBegin = size_t(r.ReadNumber());
+    item.SourceEnd = size_t(r.ReadNumber());
+
+    Appcast::Enclosure& enclosure = item.enclosure;
+    enclosure.DownloadURL = r.ReadString();
+    for ( uint64_t count = r.ReadNumber(); count; count-- )
+        enclosure.MirrorURLs.push_back(r.ReadString());
+    enclosure.DsaSignature = r.ReadString();
+    enclosure.EdDsaSignature = r.ReadString();
+    enclosure.EdDsaTreeSignature = r.ReadString();
+    enclosure.EdKeyId = r.ReadString();
+    enclosure.OS = r.ReadString();
+    enclosure.InstallerArguments = r.ReadString();
+    enclosure.Compression = r.ReadString();
+    enclosure.SignatureOfCompressedData = r.ReadBool();
+    enclosure.DecompressedLength = r.ReadNumber();
+    enclosure.Length = r.ReadNumber();
+    enclosure.Sha256 = r.ReadString();
+    enclosure.ChunkManifestURL = r.ReadString();
+    enclosure.ChunkManifestSignature = r.ReadString();
+    return item;
+}
+
+// Parsed appcast, stored so that an unchanged feed doesn't need to be parsed
+struct AppcastSnapshot
+{
+    // feed's URL
+    std::string url;
+    // system the items were selected for
+    std::string systemKey;
+    // feed's entity tag, if the server sent one
+    std::string etag;
+    // hash of the whole feed, if it was downloaded in full
+    std::string hash;
+
+    AppcastChannel channel;
+    std::vector<Appcast> items;
+
+    static std::wstring GetPath(bool create)
+    {
+        return GetCacheDirectory(create) + L"\\appcast.snapshot";
+    }
+
+    bool Load()
+    {
+        CriticalSectionLocker lock(g_csCacheFiles);
+
+        HANDLE file = CreateFileW(GetPath(false).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if ( file == INVALID_HANDLE_VALUE )
+            return false;
+
+        bool ok = false;
+        LARGE_INTEGER size;
+        if ( GetFileSizeEx(file, &size) &&
+             size.QuadPart >= LONGLONG(sizeof(SnapshotHeader)) &&
+             size.QuadPart < MAX_CACHE_FILE_SIZE )
+        {
+            HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if ( mapping )
+            {
+                const void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                if ( view )
+                {
+                    try
+                    {
+                        Parse(static_cast<const char*>(view), size_t(size.QuadPart));
+                        ok = true;
+                    }
+                    catch ( std::runtime_error& )
+                    {
+                        // corrupted or outdated, will be overwritten
+                    }
+                    UnmapViewOfFile(view);
+                }
+                CloseHandle(mapping);
+            }
+        }
+
+        CloseHandle(file);
+        return ok;
+    }
+
+    void Save() const
+    {
+        SnapshotWriter w;
+        w.WriteString(WIN_SPARKLE_VERSION_STRING);
+        w.WriteString(url);
+        w.WriteString(systemKey);
+        w.WriteString(etag);
+        w.WriteString(hash);
+        w.WriteString(channel.NotificationURL);
+        w.WriteBool(channel.AppendOnly);
+        w.WriteNumber(items.size());
+        for ( const Appcast& item : items )
+            WriteAppcast(w, item);
+
+        const std::string& payload = w.GetData();
+
+        SnapshotHeader header;
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.size = payload.size();
+        header.checksum = SnapshotChecksum(payload.data(), payload.size());
+
+        std::string data(reinterpret_cast<const char*>(&header), sizeof(header));
+        data += payload;
+
+        CriticalSectionLocker lock(g_csCacheFiles);
+        WriteFileContents(GetPath(true), data);
+    }
+
+private:
+    void Parse(const char *data, size_t len)
+    {
+        SnapshotHeader header;
+        memcpy(&header, data, sizeof(header));
+        data += sizeof(header);
+        len -= sizeof(header);
+
+        if ( memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+             header.version != SNAPSHOT_VERSION ||
+             header.size != len ||
+             header.checksum != SnapshotChecksum(data, len) )
+        {
+            throw std::runtime_error("Invalid appcast snapshot.");
+        }
+
+        SnapshotReader r(data, len);
+        if ( r.ReadString() != WIN_SPARKLE_VERSION_STRING )
+            throw std::runtime_error("Appcast snapshot from another version.");
+        url = r.ReadString();
+        systemKey = r.ReadString();
+        etag = r.ReadString();
+        hash = r.ReadString();
+        channel.NotificationURL = r.ReadString();
+        channel.AppendOnly = r.ReadBool();
+        for ( uint64_t count = r.ReadNumber(); count; count-- )
+            items.push_back(ReadAppcast(r));
+
+        if ( !r.AtEnd() )
+            throw std::runtime_error("Invalid appcast snapshot.");
+    }
+};
+
+
+/*--------------------------------------------------------------------------*
+                           incremental loading
+ *--------------------------------------------------------------------------*/
+
+/**
+    Updates the cache after parsing feed data.
+
+    @param cache    Cache state used to construct @a doc; updated.
+    @param doc      Parsed XML data: the cached prefix followed by new data.
+    @param all      Items loaded from @a doc.
+    @param channel  Channel information loaded from @a doc.
+    @param data     Downloaded data, starting at @a base offset in the feed.
+    @param skip     How many bytes of @a data were already processed before.
+ */
+void UpdateCache(FeedCache& cache,
+                 const std::string& doc,
+                 const std::vector<Appcast>& all,
+                 const AppcastChannel& channel,
+                 const std::string& data,
+                 size_t base,
+                 size_t skip)
+{
+    // Only the newest item is needed to find the update, retain just that,
+    // together with the newest critical update, so that it's known whether
+    // any update newer than the installed version is critical. The items
+    // are already filtered for this system, which is why the cache is only
+    // valid for it.
+    const Appcast *newest = NULL;
+    const Appcast *newestCritical = NULL;
+    for ( const Appcast& item : all )
+    {
+        if ( !newest || UpdateChecker::CompareVersions(item.Version, newest->Version) > 0 )
+            newest = &item;
+        if ( item.CriticalUpdate &&
+             (!newestCritical || UpdateChecker::CompareVersions(item.Version, newestCritical->Version) > 0) )
+            newestCritical = &item;
+    }
+
+    std::vector<const Appcast*> retained;
+    if ( newest )
+        retained.push_back(newest);
+    if ( newestCritical && newestCritical != newest )
+        retained.push_back(newestCritical);
+
+    if ( cache.Update(doc, channel, retained, data, base, skip) )
+        cache.Save();
+}
+
+
+/**
+    Parses feed data, continuing after cached data, and updates the cache.
+
+    See UpdateCache() for the description of parameters.
+ */
+std::vector<Appcast> ParseAndUpdateCache(FeedCache& cache,
+                                         std::string&& data,
+                                         size_t base,
+                                         size_t skip,
+                                         AppcastChannel& channel)
+{
+    // avoid copying the data when downloading the whole feed
+    const bool continued = !cache.prefix.empty() || skip;
+    std::shared_ptr<const std::string> doc =
+        std::make_shared<const std::string>(continued ? cache.prefix + data.substr(skip)
+                                                      : std::move(data));
+
+    std::vector<Appcast> all = Appcast::Load(doc, &channel);
+
+    if ( channel.AppendOnly )
+    {
+        try
+        {
+            UpdateCache(cache, *doc, all, channel, continued ? data : *doc, base, skip);
+        }
+        catch ( std::exception& e )
+        {
+            // not fatal, the next check will just download all of the feed
+            LogError(std::string("Cannot update appcast cache: ") + e.what());
+        }
+    }
+
+    return all;
+}
+
+} // anonymous namespace
+
+
+/*--------------------------------------------------------------------------*
+                            public functions
+ *--------------------------------------------------------------------------*/
+
+std::wstring GetCacheDirectory()
+{
+    return GetCacheDirectory(true);
+}
+
+
+std::vector<Appcast> LoadAppcastFeed(const std::string& url,
+                                     Thread *onThread,
+                                     AppcastChannel& channel,
+                                     std::string *fingerprint)
+{
+    const std::string headers = Settings::GetHttpHeadersString();
+
+    // The ETag identifies the feed's content best, as it doesn't depend on
+    // how much of it was downloaded; fall back to the data's hash.
+    auto setFingerprint = [fingerprint](const std::string& etag, const std::string& hash)
+    {
+        if ( fingerprint )
+            *fingerprint = etag.empty() ? hash : etag;
+    };
+
+    if ( !Settings::IsAppcastCacheEnabled() )
+    {
+        StringDownloadSink xml;
+        DownloadFile(url, &xml, onThread, headers, Download_BypassProxies);
+        setFingerprint(xml.etag, HashRegion(xml.data, 0, xml.data.size()));
+        return Appcast::Load(std::make_shared<const std::string>(std::move(xml.data)), &channel);
+    }
+
+    // Previously parsed feed, usable if the feed didn't change:
+    AppcastSnapshot snapshot;
+    bool haveSnapshot = false;
+
+    FeedCache cache;
+    bool haveCache = false;
+
+    try
+    {
+        haveSnapshot = snapshot.Load() &&
+                       snapshot.url == url &&
+                       snapshot.systemKey == GetSystemKey();
+        haveCache = cache.Load();
+    }
+    catch ( std::exception& e )
+    {
+        LogError(std::string("Cannot use appcast cache: ") + e.what());
+    }
+
+    std::string conditionalHeaders(headers);
+    if ( haveSnapshot && !snapshot.etag.empty() )
+        conditionalHeaders += "If-None-Match: " + snapshot.etag + "\r\n";
+
+    AppcastSnapshot updated;
+    updated.url = url;
+    updated.systemKey = GetSystemKey();
+
+    std::vector<Appcast> all;
+    bool loaded = false;
+
+    if ( haveCache && cache.url == url && cache.systemKey == updated.systemKey )
+    {
+        try
+        {
+            // Download from a bit before the end of the last processed item,
+            // so that we can check that the feed still continues the same:
+            const size_t base = cache.GetResumeOffset();
+
+            StringDownloadSink tail;
+            DownloadFile(url, &tail, onThread, conditionalHeaders, Download_BypassProxies, base);
+
+            if ( tail.notModified && haveSnapshot )
+            {
+                setFingerprint(snapshot.etag, snapshot.hash);
+                channel = snapshot.channel;
+                return snapshot.items;
+            }
+
+            if ( tail.notModified || !cache.IsContinuedBy(tail.data) )
+                throw std::runtime_error("The feed was modified.");
+
+            all = ParseAndUpdateCache(cache, std::move(tail.data), base, cache.GetCheckRegionSize(), channel);
+            updated.etag = tail.etag;
+            // the feed changes only by appending, so the end of processed
+            // data identifies its content
+            setFingerprint(updated.etag, std::to_string(cache.offset) + ":" + cache.hash);
+            loaded = true;
+        }
+        catch ( std::exception& e )
+        {
+            LogError(std::string("Cannot update appcast incrementally, downloading all of it: ") + e.what());
+        }
+    }
+
+    if ( !loaded )
+    {
+        // the cache is invalid or for another feed or system, start over
+        if ( haveCache )
+            FeedCache::Delete();
+
+        StringDownloadSink xml;
+        DownloadFile(url, &xml, onThread, conditionalHeaders, Download_BypassProxies);
+
+        updated.etag = xml.etag;
+        updated.hash = HashRegion(xml.data, 0, xml.data.size());
+        setFingerprint(updated.etag, updated.hash);
+
+        // Unchanged feed, use the items loaded previously. Append-only feeds
+        // are parsed anyway, to continue incrementally next time.
+        if ( haveSnapshot &&
+             (xml.notModified || (snapshot.hash == updated.hash && !snapshot.channel.AppendOnly)) )
+        {
+            if ( xml.notModified )
+                setFingerprint(snapshot.etag, snapshot.hash);
+            channel = snapshot.channel;
+            return snapshot.items;
+        }
+        if ( xml.notModified )
+            throw std::runtime_error("Unexpected response to appcast request.");
+
+        FeedCache fresh;
+        fresh.url = url;
+        fresh.systemKey = updated.systemKey;
+        all = ParseAndUpdateCache(fresh, std::move(xml.data), 0, 0, channel);
+    }
+
+    try
+    {
+        updated.channel = channel;
+        updated.items = all;
+        updated.Save();
+    }
+    catch ( std::exception& e )
+    {
+        LogError(std::string("Cannot save appcast snapshot: ") + e.what());
+    }
+
+    return all;
+}
+
+} // namespace winsparkle
@@ -0,0 +1,83 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _feedcache_h_
+#define _feedcache_h_
+
+#include "appcast.h"
+
+#include <string>
+#include <vector>
+
+namespace winsparkle
+{
+
+class Thread;
+
+/**
+    Returns directory for WinSparkle's cached data, creating it if needed.
+
+    The directory is per-application, under the user's local application data.
+
+    Throws on error.
+ */
+std::wstring GetCacheDirectory();
+
+/**
+    Downloads and loads the appcast.
+
+    Appcasts that declare themselves append-only with <sparkle:appendOnly/>
+    are fetched incrementally: only the data added since the last check are
+    downloaded with a Range request and parsed, together with the newest
+    (and newest critical) item retained from the previous check. If the
+    cached state doesn't match the feed anymore or was created on a different
+    system (OS version or architecture), the whole feed is downloaded instead.
+
+    The loaded items are also stored in a binary snapshot, together with the
+    feed's ETag and hash. If the feed didn't change, as indicated by
+    a 304 Not Modified response to a conditional request or by the same
+    hash, the snapshot is used instead of parsing the feed again.
+
+    If the cache is disabled (see Settings::IsAppcastCacheEnabled()), the
+    whole feed is always downloaded and parsed and nothing is stored.
+
+    Throws on error.
+
+    @param url          URL of the appcast.
+    @param onThread     Thread the download runs on.
+    @param channel      Filled with the channel-level information.
+    @param fingerprint  If not NULL, set to a value that changes whenever
+                        the feed does: its ETag or hash.
+
+    @see Appcast::Load()
+ */
+std::vector<Appcast> LoadAppcastFeed(const std::string& url,
+                                     Thread *onThread,
+                                     AppcastChannel& channel,
+                                     std::string *fingerprint = NULL);
+
+} // namespace winsparkle
+
+#endif // _feedcache_h_
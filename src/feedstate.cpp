@@ -0,0 +1,118 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "feedstate.h"
+#include "hashes.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace winsparkle
+{
+
+std::string HashRegion(const std::string& data, size_t offset, size_t len)
+{
+    unsigned char hash[SHA512Hasher::HASH_SIZE];
+    SHA512Hasher::Hash(data.data() + offset, len, hash);
+    return HashToHex(hash, sizeof(hash));
+}
+
+
+std::string FeedState::Serialize() const
+{
+    std::ostringstream s;
+    s << url << '\n' << systemKey << '\n' << offset << ' ' << headLength << ' ' << hash << '\n' << prefix;
+    return s.str();
+}
+
+
+bool FeedState::Deserialize(const std::string& data)
+{
+    const size_t eol0 = data.find('\n');
+    if ( eol0 == std::string::npos )
+        return false;
+    const size_t eol1 = data.find('\n', eol0 + 1);
+    if ( eol1 == std::string::npos )
+        return false;
+    const size_t eol2 = data.find('\n', eol1 + 1);
+    if ( eol2 == std::string::npos )
+        return false;
+
+    url = data.substr(0, eol0);
+    systemKey = data.substr(eol0 + 1, eol1 - eol0 - 1);
+    std::istringstream s(data.substr(eol1 + 1, eol2 - eol1 - 1));
+    s >> offset >> headLength >> hash;
+    if ( s.fail() )
+        return false;
+    prefix = data.substr(eol2 + 1);
+
+    return offset > 0 && headLength <= prefix.size();
+}
+
+
+size_t FeedState::GetCheckRegionSize() const
+{
+    return (std::min)(offset, size_t(CHECK_REGION_SIZE));
+}
+
+
+bool FeedState::IsContinuedBy(const std::string& tail) const
+{
+    const size_t region = GetCheckRegionSize();
+    return tail.size() >= region && HashRegion(tail, 0, region) == hash;
+}
+
+
+bool FeedState::Update(const std::string& doc,
+                       const AppcastChannel& channel,
+                       std::vector<const Appcast*> retained,
+                       const std::string& data,
+                       size_t base,
+                       size_t skip)
+{
+    // Feed offset of the end of the last processed item:
+    if ( channel.ItemsEnd > prefix.size() )
+        offset = base + skip + (channel.ItemsEnd - prefix.size());
+    if ( !offset )
+        return false; // no items to continue after
+
+    if ( prefix.empty() )
+        headLength = channel.ItemsBegin;
+
+    const size_t region = GetCheckRegionSize();
+    hash = HashRegion(data, offset - region - base, region);
+
+    // keep the items in the feed's order
+    std::sort(retained.begin(), retained.end(),
+              [](const Appcast *a, const Appcast *b) { return a->SourceBegin < b->SourceBegin; });
+
+    prefix.assign(doc, 0, headLength);
+    for ( const Appcast *item : retained )
+        prefix.append(doc, item->SourceBegin, item->SourceEnd - item->SourceBegin);
+
+    return true;
+}
+
+} // namespace winsparkle
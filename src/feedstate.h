@@ -0,0 +1,110 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _feedstate_h_
+#define _feedstate_h_
+
+#include "appcast.h"
+
+#include <string>
+#include <vector>
+
+namespace winsparkle
+{
+
+/// Returns hex-encoded SHA-512 hash of @a len bytes of @a data at @a offset.
+std::string HashRegion(const std::string& data, size_t offset, size_t len);
+
+/**
+    State of an append-only feed after the last check.
+
+    The processed part of the feed, up to the end of its last item, is
+    identified by its length and by the hash of the bytes preceding its
+    end. The next check downloads the feed starting with these bytes, so
+    that it can verify the feed still continues the same, and only parses
+    the new data, preceded by the retained items.
+ */
+struct FeedState
+{
+    /// How many bytes preceding the already processed part of the feed
+    /// are downloaded again to verify the feed wasn't modified.
+    static const size_t CHECK_REGION_SIZE = 256;
+
+    FeedState() : offset(0), headLength(0) {}
+
+    // feed's URL
+    std::string url;
+    // system the retained items were selected for
+    std::string systemKey;
+    // how many bytes of the feed were processed, up to the end of last <item>
+    size_t offset;
+    // hash of GetCheckRegionSize() bytes preceding offset
+    std::string hash;
+    // XML preceding the first <item>, followed by the retained items
+    std::string prefix;
+    size_t headLength;
+
+    /// Serializes the state for storing it, see Deserialize().
+    std::string Serialize() const;
+
+    /// Loads state stored by Serialize(), returns false if it's invalid.
+    bool Deserialize(const std::string& data);
+
+    /// Size of the region verified by IsContinuedBy().
+    size_t GetCheckRegionSize() const;
+
+    /// Feed offset to continue downloading from, including the check region.
+    size_t GetResumeOffset() const { return offset - GetCheckRegionSize(); }
+
+    /**
+        Checks if the feed still continues the same as when it was processed.
+
+        @param tail  Feed data starting at GetResumeOffset().
+     */
+    bool IsContinuedBy(const std::string& tail) const;
+
+    /**
+        Updates the state after parsing feed data.
+
+        @param doc       Parsed XML data: the prefix followed by new data.
+        @param channel   Channel information loaded from @a doc.
+        @param retained  Items loaded from @a doc to keep for the next check.
+        @param data      Downloaded data, starting at @a base offset in the feed.
+        @param skip      How many bytes of @a data were already processed before.
+
+        @return false if there are no items to continue after, i.e. the state
+                isn't usable.
+     */
+    bool Update(const std::string& doc,
+                const AppcastChannel& channel,
+                std::vector<const Appcast*> retained,
+                const std::string& data,
+                size_t base,
+                size_t skip);
+};
+
+} // namespace winsparkle
+
+#endif // _feedstate_h_
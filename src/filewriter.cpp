@@ -0,0 +1,248 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "filewriter.h"
+#include "error.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace winsparkle
+{
+
+/*--------------------------------------------------------------------------*
+                             producer side
+ *--------------------------------------------------------------------------*/
+
+BackgroundFileWriter::BackgroundFileWriter(HANDLE file, Thread *producer)
+    : Thread("WinSparkle file writer"),
+      m_file(file),
+      m_producer(producer),
+      m_finishing(false), m_aborting(false), m_failed(false),
+      m_joined(false)
+{
+    Start();
+}
+
+
+BackgroundFileWriter::~BackgroundFileWriter()
+{
+    if ( !m_joined )
+    {
+        {
+            CriticalSectionLocker lock(m_cs);
+            m_aborting = true;
+        }
+        m_dataQueued.Signal();
+        Join();
+    }
+
+    for ( std::vector<char*>::const_iterator i = m_allocated.begin(); i != m_allocated.end(); ++i )
+        VirtualFree(*i, 0, MEM_RELEASE);
+}
+
+
+void BackgroundFileWriter::Write(const void *data, size_t len)
+{
+    const char *ptr = static_cast<const char*>(data);
+    while ( len )
+    {
+        if ( !m_current.data )
+            m_current = TakeFreeBlock();
+
+        const size_t chunk = std::min(len, BLOCK_SIZE - m_current.len);
+        memcpy(m_current.data + m_current.len, ptr, chunk);
+        ptr += chunk;
+        len -= chunk;
+
+        CommitBuffer(chunk);
+    }
+}
+
+
+void *BackgroundFileWriter::AcquireBuffer(size_t minLen, size_t& len)
+{
+    if ( minLen > BLOCK_SIZE )
+        return NULL;
+
+    if ( m_current.data && BLOCK_SIZE - m_current.len < minLen )
+        SubmitCurrentBlock();
+    if ( !m_current.data )
+        m_current = TakeFreeBlock();
+
+    len = BLOCK_SIZE - m_current.len;
+    return m_current.data + m_current.len;
+}
+
+
+void BackgroundFileWriter::CommitBuffer(size_t len)
+{
+    m_current.len += len;
+    if ( m_current.len == BLOCK_SIZE )
+        SubmitCurrentBlock();
+}
+
+
+void BackgroundFileWriter::Finish()
+{
+    if ( m_current.data && m_current.len )
+        SubmitCurrentBlock();
+
+    {
+        CriticalSectionLocker lock(m_cs);
+        m_finishing = true;
+    }
+    m_dataQueued.Signal();
+
+    Join();
+    m_joined = true;
+
+    CheckForError();
+}
+
+
+BackgroundFileWriter::Block BackgroundFileWriter::TakeFreeBlock()
+{
+    for ( ;; )
+    {
+        {
+            CriticalSectionLocker lock(m_cs);
+            CheckForError();
+
+            if ( !m_free.empty() )
+            {
+                Block b;
+                b.data = m_free.back();
+                m_free.pop_back();
+                return b;
+            }
+        }
+
+        if ( m_allocated.size() < MAX_BLOCKS )
+        {
+            // VirtualAlloc()'s memory is page-aligned, which is what the
+            // file system prefers to copy from
+            char *data = static_cast<char*>(VirtualAlloc(NULL, BLOCK_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+            if ( !data )
+                throw Win32Exception();
+            m_allocated.push_back(data);
+
+            Block b;
+            b.data = data;
+            return b;
+        }
+
+        // All blocks are queued for writing, wait for the disk to catch up.
+        // Don't wait forever though: the producer may be asked to terminate
+        // and if the I/O thread ended, no block will ever be freed.
+        if ( m_producer )
+            m_producer->CheckShouldTerminate();
+        if ( !m_blockFreed.WaitUntilSignaled(100) && WaitForSingleObject(m_handle, 0) == WAIT_OBJECT_0 )
+        {
+            CriticalSectionLocker lock(m_cs);
+            CheckForError();
+            if ( m_free.empty() )
+                throw std::runtime_error("Cannot write file: writer thread ended unexpectedly.");
+        }
+    }
+}
+
+
+void BackgroundFileWriter::SubmitCurrentBlock()
+{
+    {
+        CriticalSectionLocker lock(m_cs);
+        CheckForError();
+        m_queue.push_back(m_current);
+    }
+    m_current = Block();
+    m_dataQueued.Signal();
+}
+
+
+void BackgroundFileWriter::CheckForError()
+{
+    // called either with m_cs locked or after the thread ended
+    if ( m_failed )
+        throw std::runtime_error(m_error);
+}
+
+
+/*--------------------------------------------------------------------------*
+                               I/O thread
+ *--------------------------------------------------------------------------*/
+
+void BackgroundFileWriter::Run()
+{
+    SignalReady();
+
+    for ( ;; )
+    {
+        Block block;
+        bool skip;
+        {
+            CriticalSectionLocker lock(m_cs);
+            if ( m_aborting )
+                return;
+            if ( !m_queue.empty() )
+            {
+                block = m_queue.front();
+                m_queue.pop_front();
+            }
+            else if ( m_finishing )
+            {
+                return;
+            }
+            skip = m_failed;
+        }
+
+        if ( !block.data )
+        {
+            m_dataQueued.WaitUntilSignaled();
+            continue;
+        }
+
+        if ( !skip )
+        {
+            DWORD written;
+            if ( !WriteFile(m_file, block.data, (DWORD)block.len, &written, NULL) || written != block.len )
+            {
+                // can't throw from here, pass the error to the producer instead
+                const std::string error = Win32Exception("Cannot write file").what();
+                CriticalSectionLocker lock(m_cs);
+                m_failed = true;
+                m_error = error;
+            }
+        }
+
+        {
+            CriticalSectionLocker lock(m_cs);
+            m_free.push_back(block.data);
+        }
+        m_blockFreed.Signal();
+    }
+}
+
+} // namespace winsparkle
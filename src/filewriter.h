@@ -0,0 +1,138 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _filewriter_h_
+#define _filewriter_h_
+
+#include "threads.h"
+
+#include <windows.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace winsparkle
+{
+
+/**
+    Writes data to a file asynchronously, on a dedicated I/O thread.
+
+    Data are collected in large page-aligned blocks that are passed to the
+    I/O thread once full, so that the producer (typically the download loop)
+    doesn't wait for the disk. Only a few blocks exist at a time: if the disk
+    can't keep up, the producer waits until one of them is written.
+
+    Errors that occur on the I/O thread are reported by throwing from the
+    next call made by the producer.
+ */
+class BackgroundFileWriter : public Thread
+{
+public:
+    /// Size of blocks written to the file.
+    static const size_t BLOCK_SIZE = 1024 * 1024;
+
+    /// Maximum number of blocks in existence at any time.
+    static const size_t MAX_BLOCKS = 4;
+
+    /**
+        Creates the writer and starts its I/O thread.
+
+        @param file      File to write to, at its current position. The handle
+                         remains owned by the caller and must not be used or
+                         closed until Finish() returns or the writer is destroyed.
+        @param producer  Thread that writes the data, if any. While waiting for
+                         the disk, its termination is checked.
+     */
+    explicit BackgroundFileWriter(HANDLE file, Thread *producer = NULL);
+
+    /**
+        Stops the I/O thread.
+
+        Data not written yet by Finish() are discarded.
+     */
+    virtual ~BackgroundFileWriter();
+
+    /// Queues @a len bytes of @a data for writing.
+    void Write(const void *data, size_t len);
+
+    /**
+        Returns memory to put the data to write into directly.
+
+        Returns NULL if @a minLen is larger than BLOCK_SIZE; use Write()
+        in that case.
+
+        @see IDownloadSink::AcquireBuffer()
+     */
+    void *AcquireBuffer(size_t minLen, size_t& len);
+
+    /// Queues @a len bytes written into memory returned by AcquireBuffer().
+    void CommitBuffer(size_t len);
+
+    /**
+        Writes all remaining data and stops the I/O thread.
+
+        Throws if any write failed.
+     */
+    void Finish();
+
+protected:
+    virtual void Run();
+    virtual bool IsJoinable() const { return true; }
+
+private:
+    struct Block
+    {
+        Block() : data(NULL), len(0) {}
+        char *data;
+        size_t len;
+    };
+
+    Block TakeFreeBlock();
+    void SubmitCurrentBlock();
+    void CheckForError();
+
+    HANDLE m_file;
+    Thread *m_producer;
+
+    // all allocated memory blocks
+    std::vector<char*> m_allocated;
+
+    // block currently being filled by the producer
+    Block m_current;
+
+    // shared state, guarded by m_cs:
+    CriticalSection m_cs;
+    std::deque<Block> m_queue;     // blocks waiting to be written
+    std::vector<char*> m_free;     // blocks available for reuse
+    bool m_finishing, m_aborting, m_failed;
+    std::string m_error;
+
+    Event m_dataQueued, m_blockFreed;
+    bool m_joined;
+};
+
+} // namespace winsparkle
+
+#endif // _filewriter_h_
@@ -0,0 +1,111 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "hashes.h"
+
+#include <stdexcept>
+#include <string.h>
+
+// This file only contains platform-independent code, the hashers that use
+// Windows' CNG are implemented in cnghashers.cpp.
+
+namespace winsparkle
+{
+
+/*--------------------------------------------------------------------------*
+                                TreeHasher
+ *--------------------------------------------------------------------------*/
+
+namespace
+{
+
+const unsigned char TREE_LEAF_PREFIX = 0x00;
+const unsigned char TREE_NODE_PREFIX = 0x01;
+
+} // anonymous namespace
+
+
+void TreeHasher::HashLeaf(const void *data, size_t len, unsigned char hash[HASH_SIZE])
+{
+    SHA512Hasher hasher;
+    hasher.Update(&TREE_LEAF_PREFIX, 1);
+    hasher.Update(data, len);
+    hasher.Final(hash);
+}
+
+
+void TreeHasher::Root(const std::string& leaves, unsigned char root[HASH_SIZE])
+{
+    if ( leaves.empty() || leaves.size() % HASH_SIZE != 0 )
+        throw std::runtime_error("Invalid tree hash leaves.");
+
+    std::string level(leaves);
+    while ( level.size() > HASH_SIZE )
+    {
+        std::string next;
+        next.reserve((level.size() / HASH_SIZE + 1) / 2 * HASH_SIZE);
+
+        for ( size_t i = 0; i < level.size(); i += 2 * HASH_SIZE )
+        {
+            if ( i + HASH_SIZE == level.size() )
+            {
+                next.append(level, i, HASH_SIZE);
+                break;
+            }
+
+            unsigned char node[HASH_SIZE];
+            SHA512Hasher hasher;
+            hasher.Update(&TREE_NODE_PREFIX, 1);
+            hasher.Update(level.data() + i, 2 * HASH_SIZE);
+            hasher.Final(node);
+            next.append(reinterpret_cast<const char*>(node), HASH_SIZE);
+        }
+
+        level.swap(next);
+    }
+
+    memcpy(root, level.data(), HASH_SIZE);
+}
+
+
+/*--------------------------------------------------------------------------*
+                                  helpers
+ *--------------------------------------------------------------------------*/
+
+std::string HashToHex(const unsigned char *hash, size_t len)
+{
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+
+    std::string hex;
+    hex.reserve(2 * len);
+    for ( size_t i = 0; i < len; i++ )
+    {
+        hex += HEX_DIGITS[hash[i] >> 4];
+        hex += HEX_DIGITS[hash[i] & 0x0F];
+    }
+    return hex;
+}
+
+} // namespace winsparkle
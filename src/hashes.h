@@ -0,0 +1,138 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _hashes_h_
+#define _hashes_h_
+
+#include <stddef.h>
+#include <string>
+
+extern "C"
+{
+#include <sha512.h>
+}
+
+namespace winsparkle
+{
+
+/**
+    Computes SHA-512 hash of data passed to it piece by piece.
+
+    Windows' CNG implementation is used if it is available, because it picks
+    code optimized for the CPU at runtime (e.g. using SHA extensions or
+    AVX2). Otherwise, the portable implementation from the ed25519 library
+    is used. Both produce identical output.
+ */
+class SHA512Hasher
+{
+public:
+    /// Size of the hash, in bytes.
+    static const size_t HASH_SIZE = 64;
+
+    /// Throws on error.
+    SHA512Hasher();
+    ~SHA512Hasher();
+
+    SHA512Hasher(const SHA512Hasher&) = delete;
+    SHA512Hasher& operator=(const SHA512Hasher&) = delete;
+
+    /// Add next piece of the data.
+    void Update(const void *data, size_t len);
+
+    /// Get the hash of all data passed to Update(); the hasher can't be
+    /// used anymore afterwards.
+    void Final(unsigned char hash[HASH_SIZE]);
+
+    /// Computes the hash of @a data in one go.
+    static void Hash(const void *data, size_t len, unsigned char hash[HASH_SIZE]);
+
+private:
+    void *m_cngHash;
+    sha512_context m_fallback;
+};
+
+/**
+    Computes SHA-256 hash of data passed to it piece by piece.
+
+    Uses Windows' CNG implementation, which uses SHA extensions of the CPU
+    if available.
+ */
+class SHA256Hasher
+{
+public:
+    /// Size of the hash, in bytes.
+    static const size_t HASH_SIZE = 32;
+
+    /// Throws on error.
+    SHA256Hasher();
+    ~SHA256Hasher();
+
+    SHA256Hasher(const SHA256Hasher&) = delete;
+    SHA256Hasher& operator=(const SHA256Hasher&) = delete;
+
+    /// Add next piece of the data.
+    void Update(const void *data, size_t len);
+
+    /// Get the hash of all data passed to Update(); the hasher can't be
+    /// used anymore afterwards.
+    void Final(unsigned char hash[HASH_SIZE]);
+
+private:
+    void *m_cngHash;
+};
+
+/**
+    Computes the root hash of a Merkle tree built over some data, which is
+    what tree signatures (sparkle:edSignatureTree) sign. Unlike a hash of
+    the whole data, it can be computed on several threads at once.
+
+    The data are split into leaves of LEAF_SIZE bytes; only the last one may
+    be shorter and empty data have one empty leaf. The hash of a leaf is
+    SHA-512(0x00 || leaf), the hash of an inner node is
+    SHA-512(0x01 || left || right). A node without a sibling moves up to
+    the next level unchanged.
+ */
+class TreeHasher
+{
+public:
+    /// Size of the hashes, in bytes.
+    static const size_t HASH_SIZE = SHA512Hasher::HASH_SIZE;
+
+    /// Size of the leaves, in bytes.
+    static const size_t LEAF_SIZE = 1024 * 1024;
+
+    /// Computes the hash of a single leaf.
+    static void HashLeaf(const void *data, size_t len, unsigned char hash[HASH_SIZE]);
+
+    /// Computes the root hash from the concatenated hashes of all leaves.
+    static void Root(const std::string& leaves, unsigned char root[HASH_SIZE]);
+};
+
+/// Formats binary data, typically a hash, as lowercase hexadecimal string.
+std::string HashToHex(const unsigned char *hash, size_t len);
+
+} // namespace winsparkle
+
+#endif // _hashes_h_
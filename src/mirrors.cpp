@@ -0,0 +1,330 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "mirrors.h"
+#include "error.h"
+#include "threads.h"
+
+#include <algorithm>
+#include <windows.h>
+
+namespace winsparkle
+{
+
+/*--------------------------------------------------------------------------*
+                                 helpers
+ *--------------------------------------------------------------------------*/
+
+namespace
+{
+
+// How long to wait for mirrors to respond to probes
+const DWORD PROBE_TIMEOUT_MS = 3000;
+
+// How many times to try downloading before giving up, if there are fewer mirrors
+const size_t MIN_DOWNLOAD_ATTEMPTS = 3;
+
+// Thrown by ProbeSink to stop the download once the response arrived
+struct ProbeFinished
+{
+};
+
+struct ProbeSink : public IDownloadSink
+{
+    virtual void SetLength(size_t) {}
+    virtual void SetFilename(const std::wstring&) { throw ProbeFinished(); }
+    virtual void Add(const void*, size_t) { throw ProbeFinished(); }
+};
+
+// Measures time to first byte of a single mirror.
+class MirrorProbe : public Thread
+{
+public:
+    MirrorProbe(const std::string& url, const std::string& headers)
+        : Thread("WinSparkle mirror probe"),
+          m_url(url), m_headers(headers),
+          m_finished(false), m_succeeded(false), m_latency(0)
+    {}
+
+    bool IsFinished()
+    {
+        CriticalSectionLocker lock(m_cs);
+        return m_finished;
+    }
+
+    // Only valid after the thread finished:
+    bool Succeeded() const { return m_succeeded; }
+    DWORD GetLatency() const { return m_latency; }
+
+protected:
+    virtual void Run()
+    {
+        SignalReady();
+
+        const DWORD start = GetTickCount();
+        try
+        {
+            ProbeSink sink;
+            DownloadFile(m_url, &sink, this, m_headers + "Range: bytes=0-0\r\n");
+            // an empty file, but it's a response nevertheless
+            m_succeeded = true;
+        }
+        catch ( ProbeFinished& )
+        {
+            m_succeeded = true;
+        }
+        catch ( ... )
+        {
+            // the mirror doesn't work or the probe was terminated
+        }
+        m_latency = GetTickCount() - start;
+
+        CriticalSectionLocker lock(m_cs);
+        m_finished = true;
+    }
+
+    virtual bool IsJoinable() const { return true; }
+
+private:
+    std::string m_url, m_headers;
+    CriticalSection m_cs;
+    bool m_finished;
+    bool m_succeeded;
+    DWORD m_latency;
+};
+
+struct MirrorRank
+{
+    std::string url;
+    bool ok;
+    DWORD latency;
+
+    bool operator<(const MirrorRank& other) const
+    {
+        if ( ok != other.ok )
+            return ok;
+        return ok && latency < other.latency;
+    }
+};
+
+// Passes data to the real sink, keeping track of how much of them it got
+// and of whether it was the sink that failed.
+struct FailoverSink : public IDownloadSink
+{
+    FailoverSink(IDownloadSink& target)
+        : m_target(target), m_received(0),
+          m_lengthSet(false), m_filenameSet(false), m_sinkFailed(false)
+    {}
+
+    size_t GetReceived() const { return m_received; }
+    bool SinkFailed() const { return m_sinkFailed; }
+
+    // A new mirror may report the length and filename again; only the
+    // first occurrence counts.
+
+    virtual void SetLength(size_t len)
+    {
+        if ( m_lengthSet )
+            return;
+        m_lengthSet = true;
+        CallSink([&]{ m_target.SetLength(len); });
+    }
+
+    virtual void SetFilename(const std::wstring& filename)
+    {
+        if ( m_filenameSet )
+            return;
+        m_filenameSet = true;
+        CallSink([&]{ m_target.SetFilename(filename); });
+    }
+
+    virtual void Add(const void *data, size_t len)
+    {
+        CallSink([&]{ m_target.Add(data, len); });
+        m_received += len;
+    }
+
+    virtual void *AcquireBuffer(size_t minLen, size_t& len)
+    {
+        void *buffer = NULL;
+        CallSink([&]{ buffer = m_target.AcquireBuffer(minLen, len); });
+        return buffer;
+    }
+
+    virtual void CommitBuffer(size_t len)
+    {
+        CallSink([&]{ m_target.CommitBuffer(len); });
+        m_received += len;
+    }
+
+private:
+    template<typename F>
+    void CallSink(F f)
+    {
+        try
+        {
+            f();
+        }
+        catch ( CorruptedDataException& e )
+        {
+            // the sink discarded the damaged data, continue before them
+            m_received = e.GetValidLength();
+            throw;
+        }
+        catch ( ... )
+        {
+            m_sinkFailed = true;
+            throw;
+        }
+    }
+
+    IDownloadSink& m_target;
+    size_t m_received;
+    bool m_lengthSet, m_filenameSet;
+    bool m_sinkFailed;
+};
+
+} // anonymous namespace
+
+
+/*--------------------------------------------------------------------------*
+                             public functions
+ *--------------------------------------------------------------------------*/
+
+std::vector<std::string> RankMirrorsByLatency(const std::vector<std::string>& urls,
+                                              Thread *onThread,
+                                              const std::string& headers)
+{
+    if ( urls.size() < 2 )
+        return urls;
+
+    std::vector<MirrorProbe*> probes;
+    std::vector<MirrorRank> ranks;
+
+    try
+    {
+        for ( std::vector<std::string>::const_iterator i = urls.begin(); i != urls.end(); ++i )
+        {
+            probes.push_back(new MirrorProbe(*i, headers));
+            probes.back()->Start();
+        }
+
+        const DWORD start = GetTickCount();
+        for ( ;; )
+        {
+            if ( onThread )
+                onThread->CheckShouldTerminate();
+
+            size_t finished = 0;
+            for ( std::vector<MirrorProbe*>::const_iterator i = probes.begin(); i != probes.end(); ++i )
+            {
+                if ( (*i)->IsFinished() )
+                    finished++;
+            }
+
+            if ( finished == probes.size() || GetTickCount() - start >= PROBE_TIMEOUT_MS )
+                break;
+
+            Sleep(20);
+        }
+
+        for ( size_t i = 0; i < probes.size(); i++ )
+        {
+            // probes that didn't finish yet are too slow, stop them
+            const bool finished = probes[i]->IsFinished();
+            probes[i]->TerminateAndJoin();
+
+            MirrorRank rank;
+            rank.url = urls[i];
+            rank.ok = finished && probes[i]->Succeeded();
+            rank.latency = probes[i]->GetLatency();
+            ranks.push_back(rank);
+        }
+    }
+    catch ( ... )
+    {
+        for ( std::vector<MirrorProbe*>::iterator i = probes.begin(); i != probes.end(); ++i )
+        {
+            (*i)->TerminateAndJoin();
+            delete *i;
+        }
+        throw;
+    }
+
+    for ( std::vector<MirrorProbe*>::iterator i = probes.begin(); i != probes.end(); ++i )
+        delete *i;
+
+    std::stable_sort(ranks.begin(), ranks.end());
+
+    std::vector<std::string> ranked;
+    for ( std::vector<MirrorRank>::const_iterator i = ranks.begin(); i != ranks.end(); ++i )
+        ranked.push_back(i->url);
+    return ranked;
+}
+
+
+void DownloadFileWithFailover(const std::vector<std::string>& urls,
+                              IDownloadSink *sink,
+                              Thread *onThread,
+                              const std::string& headers)
+{
+    if ( urls.empty() )
+        throw std::runtime_error("No download URL.");
+
+    FailoverSink failover(*sink);
+
+    // Stalled or dropped connections are retried (resuming) even with a
+    // single mirror; with several mirrors, each is tried at least once.
+    const size_t attempts = (std::max)(urls.size(), MIN_DOWNLOAD_ATTEMPTS);
+
+    // Failures don't count against the limit if the download progressed
+    // since the previous one, so that a long download over a poor connection
+    // isn't abandoned because of occasional errors.
+    size_t failures = 0;
+    size_t failedAt = 0;
+
+    for ( size_t i = 0; ; i++ )
+    {
+        const std::string& url = urls[i % urls.size()];
+        try
+        {
+            DownloadFile(url, &failover, onThread, headers, 0, failover.GetReceived());
+            return;
+        }
+        catch ( std::exception& e )
+        {
+            if ( failover.GetReceived() > failedAt )
+                failures = 0;
+            failedAt = failover.GetReceived();
+
+            if ( failover.SinkFailed() || ++failures == attempts )
+                throw;
+
+            LogError("Downloading from " + url + " failed (" + e.what() + "), retrying.");
+        }
+    }
+}
+
+} // namespace winsparkle
@@ -0,0 +1,76 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _mirrors_h_
+#define _mirrors_h_
+
+#include "download.h"
+
+#include <string>
+#include <vector>
+
+namespace winsparkle
+{
+
+class Thread;
+
+/**
+    Orders download mirrors by their responsiveness.
+
+    All URLs are probed in parallel with a tiny range request and sorted by
+    time to first byte, fastest first. Mirrors that failed or didn't respond
+    in time are put last, in their original order.
+
+    @param urls      Mirror URLs of the same file.
+    @param onThread  Thread the probing runs on.
+    @param headers   HTTP headers to send with the requests.
+ */
+std::vector<std::string> RankMirrorsByLatency(const std::vector<std::string>& urls,
+                                              Thread *onThread,
+                                              const std::string& headers = "");
+
+/**
+    Downloads a file from the first of several mirrors that works.
+
+    If a download fails, it is resumed from the next mirror, continuing
+    where the failed one stopped. The mirrors are cycled through for
+    a few attempts, so that a stalled connection is retried even if there's
+    only one mirror; the attempts are counted anew whenever a download gets
+    further than the previous one. Errors caused by the sink
+    are not retried, except for CorruptedDataException, after which the
+    damaged data are downloaded again.
+
+    Throws if all attempts failed.
+
+    @see DownloadFile()
+ */
+void DownloadFileWithFailover(const std::vector<std::string>& urls,
+                              IDownloadSink *sink,
+                              Thread *onThread,
+                              const std::string& headers = "");
+
+} // namespace winsparkle
+
+#endif // _mirrors_h_
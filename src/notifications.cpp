@@ -0,0 +1,187 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "notifications.h"
+#include "download.h"
+#include "settings.h"
+#include "error.h"
+
+#include <algorithm>
+#include <windows.h>
+
+namespace winsparkle
+{
+
+/*--------------------------------------------------------------------------*
+                                 helpers
+ *--------------------------------------------------------------------------*/
+
+namespace
+{
+
+// Delay before reconnecting, doubled after every failed attempt
+const unsigned MIN_RECONNECT_DELAY_MS = 30 * 1000;
+const unsigned MAX_RECONNECT_DELAY_MS = 30 * 60 * 1000;
+
+// How long StopAll() waits for the listeners to finish
+const unsigned STOP_TIMEOUT_MS = 5 * 1000;
+
+} // anonymous namespace
+
+
+/*--------------------------------------------------------------------------*
+                          NotificationListener
+ *--------------------------------------------------------------------------*/
+
+CriticalSection NotificationListener::ms_runningCS;
+std::set<NotificationListener*> NotificationListener::ms_running;
+
+
+NotificationListener::NotificationListener(const std::string& url)
+    : Thread("WinSparkle notifications"),
+      m_url(url),
+      m_connected(false),
+      m_serverRetryDelay(0)
+{
+}
+
+
+bool NotificationListener::IsConnected()
+{
+    CriticalSectionLocker lock(m_cs);
+    return m_connected;
+}
+
+
+void NotificationListener::SetConnected(bool connected)
+{
+    CriticalSectionLocker lock(m_cs);
+    m_connected = connected;
+}
+
+
+void NotificationListener::OnConnected()
+{
+    SetConnected(true);
+}
+
+
+void NotificationListener::OnNotification()
+{
+    m_notificationEvent.Signal();
+}
+
+
+void NotificationListener::OnRetryDelay(unsigned delayMilliseconds)
+{
+    m_serverRetryDelay = delayMilliseconds;
+}
+
+
+/*static*/ void NotificationListener::StopAll()
+{
+    {
+        CriticalSectionLocker lock(ms_runningCS);
+        for ( NotificationListener *listener : ms_running )
+            listener->m_terminateEvent.Signal();
+    }
+
+    // The listeners check for termination frequently, but they are owned
+    // by another thread, so we can't join them; wait until they are done.
+    const DWORD start = GetTickCount();
+    for ( ;; )
+    {
+        {
+            CriticalSectionLocker lock(ms_runningCS);
+            if ( ms_running.empty() )
+                return;
+        }
+        if ( GetTickCount() - start >= STOP_TIMEOUT_MS )
+            return;
+        Sleep(50);
+    }
+}
+
+
+void NotificationListener::Run()
+{
+    // Keep track of running listeners for StopAll(). The thread may end
+    // with an exception (e.g. when terminated), so do it in a destructor.
+    struct RunningGuard
+    {
+        RunningGuard(NotificationListener *listener) : m_listener(listener)
+        {
+            CriticalSectionLocker lock(ms_runningCS);
+            ms_running.insert(m_listener);
+        }
+        ~RunningGuard()
+        {
+            CriticalSectionLocker lock(ms_runningCS);
+            ms_running.erase(m_listener);
+        }
+        NotificationListener *m_listener;
+    };
+    RunningGuard guard(this);
+
+    // no initialization to do, so signal readiness immediately
+    SignalReady();
+
+    unsigned delay = 0;
+
+    for ( ;; )
+    {
+        try
+        {
+            EventStreamParser parser(*this);
+            DownloadFile(m_url,
+                         &parser,
+                         this,
+                         Settings::GetHttpHeadersString() +
+                             "Accept: text/event-stream\r\n"
+                             "Cache-Control: no-cache\r\n",
+                         Download_BypassProxies | Download_Streaming);
+        }
+        catch ( std::exception& e )
+        {
+            LogError(std::string("Notifications connection failed: ") + e.what());
+        }
+
+        // Start over with short delay if we were connected, i.e. the server
+        // is working and only closed the stream. Otherwise back off.
+        if ( IsConnected() || !delay )
+            delay = MIN_RECONNECT_DELAY_MS;
+        else
+            delay = (std::min)(delay * 2, MAX_RECONNECT_DELAY_MS);
+        SetConnected(false);
+
+        // the server may ask for longer delay, but not unreasonably long
+        const unsigned wait = (std::min)((std::max)(delay, m_serverRetryDelay),
+                                         MAX_RECONNECT_DELAY_MS);
+        if ( m_terminateEvent.WaitUntilSignaled(wait) )
+            return;
+    }
+}
+
+} // namespace winsparkle
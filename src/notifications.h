@@ -0,0 +1,96 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _notifications_h_
+#define _notifications_h_
+
+#include "threads.h"
+#include "eventstream.h"
+
+#include <set>
+#include <string>
+
+namespace winsparkle
+{
+
+/**
+    Listens for release announcements on a server-sent events stream.
+
+    The thread keeps a connection to the notification URL declared in the
+    appcast open and signals GetNotificationEvent() whenever the server sends
+    an event. If the connection is lost, it reconnects after a delay that
+    increases with repeated failures.
+ */
+class NotificationListener : public Thread, public IEventStreamHandler
+{
+public:
+    /// Creates listener thread for given URL.
+    NotificationListener(const std::string& url);
+
+    /// URL the listener is connected to.
+    const std::string& GetURL() const { return m_url; }
+
+    /// Event signaled when a new release is announced.
+    Event& GetNotificationEvent() { return m_notificationEvent; }
+
+    /// Is the connection to the server currently established?
+    bool IsConnected();
+
+    /**
+        Stops all running listeners.
+
+        Waits (for a limited time) until their threads finish. Called from
+        win_sparkle_cleanup(), because the listeners are owned by the
+        periodic checker thread, which isn't shut down.
+     */
+    static void StopAll();
+
+    // IEventStreamHandler methods, called by the stream parser
+    virtual void OnConnected();
+    virtual void OnNotification();
+    virtual void OnRetryDelay(unsigned delayMilliseconds);
+
+protected:
+    virtual void Run();
+    virtual bool IsJoinable() const { return true; }
+
+private:
+    void SetConnected(bool connected);
+
+    // running listeners, for StopAll()
+    static CriticalSection ms_runningCS;
+    static std::set<NotificationListener*> ms_running;
+
+    const std::string m_url;
+    Event m_notificationEvent;
+
+    CriticalSection m_cs;
+    bool m_connected;
+    unsigned m_serverRetryDelay;
+};
+
+} // namespace winsparkle
+
+#endif // _notifications_h_
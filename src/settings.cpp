@@ -30,6 +30,8 @@
 #include "threads.h"
 #include "signatureverifier.h"
 
+#include <algorithm>
+
 
 namespace winsparkle
 {
@@ -43,10 +45,15 @@ std::wstring Settings::ms_appName;
 std::wstring Settings::ms_appVersion;
 std::wstring Settings::ms_appBuildVersion;
 std::string  Settings::ms_DSAPubKey;
-std::string  Settings::ms_EdDSAPubKey;
+std::vector<std::string> Settings::ms_EdDSAPubKeys;
+bool         Settings::ms_EdDSAPubKeysSet = false;
 std::map<std::string, std::string> Settings::ms_httpHeaders;
+Settings::NetworkLimits Settings::ms_networkLimits;
+int          Settings::ms_adaptiveCheckMaxInterval = 0;
+int          Settings::ms_appcastCache = -1;
 
 win_sparkle_config_methods_t Settings::ms_configMethods = GetDefaultConfigMethods();
+bool         Settings::ms_customConfigMethods = false;
 
 /*--------------------------------------------------------------------------*
                              resources access
@@ -165,6 +172,17 @@ std::string Settings::GetCustomResource(const char *name, const char *type)
 }
 
 
+std::vector<std::string> Settings::SplitEdDSAPubKeys(const std::string& keys)
+{
+    std::vector<std::string> list;
+    std::istringstream in(keys);
+    std::string key;
+    while ( in >> key )
+        list.push_back(key);
+    return list;
+}
+
+
 /*--------------------------------------------------------------------------*
                              runtime config access
  *--------------------------------------------------------------------------*/
@@ -356,7 +374,25 @@ void Settings::SetEdDSAPubKey(const std::string& pubkey_base64)
 {
     CriticalSectionLocker lock(ms_csVars);
     SignatureVerifier::VerifyEdDSAPubKey(pubkey_base64);
-    ms_EdDSAPubKey = pubkey_base64;
+    ms_EdDSAPubKeys.assign(1, pubkey_base64);
+    ms_EdDSAPubKeysSet = true;
+}
+
+void Settings::AddEdDSAPubKey(const std::string& pubkey_base64)
+{
+    CriticalSectionLocker lock(ms_csVars);
+    SignatureVerifier::VerifyEdDSAPubKey(pubkey_base64);
+
+    // keys set with the API replace those from the resources, even if they
+    // were already loaded
+    if (!ms_EdDSAPubKeysSet)
+    {
+        ms_EdDSAPubKeys.clear();
+        ms_EdDSAPubKeysSet = true;
+    }
+
+    if (std::find(ms_EdDSAPubKeys.begin(), ms_EdDSAPubKeys.end(), pubkey_base64) == ms_EdDSAPubKeys.end())
+        ms_EdDSAPubKeys.push_back(pubkey_base64);
 }
 
 } // namespace winsparkle
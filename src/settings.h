@@ -33,6 +33,7 @@
 #include <map>
 #include <string>
 #include <sstream>
+#include <vector>
 
 
 namespace winsparkle
@@ -122,13 +123,13 @@ public:
         return ms_DSAPubKey;
     }
 
-    /// Return EdDSA public key to verify update file signature
-    static const std::string& GetEdDSAPubKey()
+    /// Return EdDSA public keys trusted to sign update files, in base64
+    static std::vector<std::string> GetEdDSAPubKeys()
     {
         CriticalSectionLocker lock(ms_csVars);
-        if (ms_EdDSAPubKey.empty())
-            ms_EdDSAPubKey = GetCustomResource("EdDSAPub", "EDDSA");
-        return ms_EdDSAPubKey;
+        if (!ms_EdDSAPubKeysSet && ms_EdDSAPubKeys.empty())
+            ms_EdDSAPubKeys = SplitEdDSAPubKeys(GetCustomResource("EdDSAPub", "EDDSA"));
+        return ms_EdDSAPubKeys;
     }
 
     /// Return true if DSA public key is available
@@ -147,7 +148,7 @@ public:
     {
         try
         {
-            return !GetEdDSAPubKey().empty();
+            return !GetEdDSAPubKeys().empty();
         }
         CATCH_ALL_EXCEPTIONS
         return false;
@@ -242,6 +243,77 @@ public:
         ms_httpHeaders.clear();
     }
 
+    /// Network timeouts and limits; all values in seconds, 0 means no limit
+    struct NetworkLimits
+    {
+        NetworkLimits()
+            : connectTimeout(0), firstByteTimeout(60), inactivityTimeout(30),
+              minSpeed(0), minSpeedPeriod(0)
+        {}
+
+        int connectTimeout;
+        int firstByteTimeout;
+        int inactivityTimeout;
+        int minSpeed;       // in bytes per second
+        int minSpeedPeriod;
+    };
+
+    /// Get network timeouts and limits
+    static NetworkLimits GetNetworkLimits()
+    {
+        CriticalSectionLocker lock(ms_csVars);
+        return ms_networkLimits;
+    }
+
+    /// Set network timeouts
+    static void SetDownloadTimeouts(int connect, int firstByte, int inactivity)
+    {
+        CriticalSectionLocker lock(ms_csVars);
+        ms_networkLimits.connectTimeout = connect;
+        ms_networkLimits.firstByteTimeout = firstByte;
+        ms_networkLimits.inactivityTimeout = inactivity;
+    }
+
+    /// Set minimal download speed
+    static void SetDownloadMinSpeed(int bytesPerSec, int period)
+    {
+        CriticalSectionLocker lock(ms_csVars);
+        ms_networkLimits.minSpeed = bytesPerSec;
+        ms_networkLimits.minSpeedPeriod = period;
+    }
+
+    /// Get maximum interval for adaptive update checks, 0 if disabled
+    static int GetAdaptiveCheckMaxInterval()
+    {
+        CriticalSectionLocker lock(ms_csVars);
+        return ms_adaptiveCheckMaxInterval;
+    }
+
+    /// Set maximum interval for adaptive update checks
+    static void SetAdaptiveCheckMaxInterval(int interval)
+    {
+        CriticalSectionLocker lock(ms_csVars);
+        ms_adaptiveCheckMaxInterval = interval;
+    }
+
+    /// Is caching of appcast data on disk enabled?
+    static bool IsAppcastCacheEnabled()
+    {
+        CriticalSectionLocker lock(ms_csVars);
+        // By default, don't write any files if the application took over
+        // storing of the settings with custom config methods.
+        if ( ms_appcastCache < 0 )
+            return !ms_customConfigMethods;
+        return ms_appcastCache != 0;
+    }
+
+    /// Enable or disable caching of appcast data on disk
+    static void SetAppcastCacheEnabled(bool enabled)
+    {
+        CriticalSectionLocker lock(ms_csVars);
+        ms_appcastCache = enabled ? 1 : 0;
+    }
+
     /// Set application's build version number
     static void SetAppBuildVersion(const wchar_t *version)
     {
@@ -279,6 +351,7 @@ public:
     {
         CriticalSectionLocker lock(ms_csVars);
         ms_configMethods = customConfigMethods ? *customConfigMethods : GetDefaultConfigMethods();
+        ms_customConfigMethods = customConfigMethods != NULL;
     }
 
     /// Set PEM data and verify that it contains valid DSA public key
@@ -287,6 +360,9 @@ public:
 
     /// Set base64-encoded data and verify it contains valid EdDSA public key
     static void SetEdDSAPubKey(const std::string& pubkey_base64);
+
+    /// Add another trusted EdDSA public key, verifying it first
+    static void AddEdDSAPubKey(const std::string& pubkey_base64);
     //@}
 
     /**
@@ -372,6 +448,8 @@ private:
     static std::wstring DoGetVerInfoField(const wchar_t *field, bool fatal);
     // Gets custom win32 resource data
     static std::string GetCustomResource(const char *name, const char *type);
+    // Splits whitespace-separated list of keys
+    static std::vector<std::string> SplitEdDSAPubKeys(const std::string& keys);
 
     static std::string GetDefaultRegistryPath();
 
@@ -394,9 +472,14 @@ private:
     static std::wstring ms_appVersion;
     static std::wstring ms_appBuildVersion;
     static std::string  ms_DSAPubKey;
-    static std::string  ms_EdDSAPubKey;
+    static std::vector<std::string> ms_EdDSAPubKeys;
+    static bool         ms_EdDSAPubKeysSet;  // set with the API, not from resources
     static std::map<std::string, std::string> ms_httpHeaders;
+    static NetworkLimits ms_networkLimits;
+    static int          ms_adaptiveCheckMaxInterval;
+    static int          ms_appcastCache;
     static win_sparkle_config_methods_t ms_configMethods;
+    static bool         ms_customConfigMethods;
 };
 
 } // namespace winsparkle
@@ -25,8 +25,10 @@
 
 #include "signatureverifier.h"
 
+#include "base64.h"
 #include "error.h"
 #include "settings.h"
+#include "threads.h"
 #include "utils.h"
 
 #include <openssl/dsa.h>
@@ -36,15 +38,18 @@
 
 #include <ed25519.h>
 
+extern "C"
+{
+#include <ge.h>
+#include <sc.h>
+}
+
+#include <algorithm>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
 #include <windows.h>
-#include <wincrypt.h>
-
-#ifdef _MSC_VER
-#pragma comment(lib, "crypt32.lib")
-#endif
 
 namespace winsparkle
 {
@@ -72,88 +77,6 @@ public:
     }
 };
 
-class WinCryptRSAContext
-{
-    HCRYPTPROV handle;
-
-    WinCryptRSAContext(const WinCryptRSAContext &);
-    WinCryptRSAContext &operator=(const WinCryptRSAContext &);
-public:
-    WinCryptRSAContext()
-    {
-        if (!CryptAcquireContextW(&handle, NULL, NULL, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT))
-            throw Win32Exception("Failed to create crypto context");
-    }
-
-    ~WinCryptRSAContext()
-    {
-        if (!CryptReleaseContext(handle, 0))
-            LogError("Failed to release crypto context");
-    }
-
-    operator HCRYPTPROV()
-    {
-        return handle;
-    }
-};
-
-class WinCryptSHA1Hash
-{
-    HCRYPTHASH handle;
-
-    WinCryptSHA1Hash(const WinCryptSHA1Hash&);
-    WinCryptSHA1Hash& operator=(const WinCryptSHA1Hash &);
-public:
-    WinCryptSHA1Hash(WinCryptRSAContext &context)
-    {
-        if (!CryptCreateHash(HCRYPTPROV(context), CALG_SHA1, 0, 0, &handle))
-            throw Win32Exception("Failed to create crypto hash");
-    }
-
-    ~WinCryptSHA1Hash()
-    {
-        if (handle)
-        {
-            if (!CryptDestroyHash(handle))
-            {
-                LogError("Failed to destroy crypto hash");
-            }
-        }
-    }
-
-    void hashData(const void *buffer, size_t buffer_len)
-    {
-        if (!CryptHashData(handle, (CONST BYTE  *)buffer, (DWORD)buffer_len, 0))
-            throw Win32Exception("Failed to hash data");
-    }
-
-    void hashFile(const std::wstring &filename)
-    {
-        CFile f(_wfopen(filename.c_str(), L"rb"));
-        if (!f)
-            throw std::runtime_error(WideToAnsi(L"Failed to open file " + filename));
-
-        const int BUF_SIZE = 8192;
-        unsigned char buf[BUF_SIZE];
-
-        while (size_t read_bytes = fread(buf, 1, BUF_SIZE, f))
-        {
-            hashData(buf, read_bytes);
-        }
-
-        if (ferror(f))
-            throw std::runtime_error(WideToAnsi(L"Failed to read file " + filename));
-    }
-
-    void sha1Val(unsigned char(&sha1)[SHA_DIGEST_LENGTH])
-    {
-        DWORD hash_len = SHA_DIGEST_LENGTH;
-        if (!CryptGetHashParam(handle, HP_HASHVAL, sha1, &hash_len, 0))
-            throw Win32Exception("Failed to get SHA1 val");
-    }
-
-};
-
 /**
     Light-weight dynamic loader of OpenSSL library.
     Loads only minimum required symbols, just enough to verify DSA SHA1 signature of the file.
@@ -172,25 +95,11 @@ public:
     {
     }
 
-    void VerifyDSASHA1Signature(const std::wstring &filename, const std::string &signature)
+    // Verifies DSA signature of SHA-1 hash of SHA-1 hash of the data.
+    void VerifyDSASHA1Signature(const unsigned char (&data_sha1)[SHA_DIGEST_LENGTH], const std::string &signature)
     {
         unsigned char sha1[SHA_DIGEST_LENGTH];
-
-        {
-            WinCryptRSAContext ctx;
-            // SHA1 of file
-            {
-                WinCryptSHA1Hash hash(ctx);
-                hash.hashFile(filename);
-                hash.sha1Val(sha1);
-            }
-            // SHA1 of SHA1 of file
-            {
-                WinCryptSHA1Hash hash(ctx);
-                hash.hashData(sha1, ARRAYSIZE(sha1));
-                hash.sha1Val(sha1);
-            }
-        }
+        SHA1(data_sha1, SHA_DIGEST_LENGTH, sha1);
 
         DSAPub pubKey(Settings::GetDSAPubKeyPem());
 
@@ -265,30 +174,212 @@ public:
 
 }; // TinySSL
 
-std::string Base64ToBin(const std::string &base64)
+// Don't use more threads than this for computing tree hashes
+const size_t TREE_HASH_MAX_THREADS = 16;
+
+// Hashes a range of leaves of a file for its tree hash.
+class TreeLeavesHasher : public Thread
 {
-    DWORD nDestinationSize = 0;
-    std::string bin;
+public:
+    TreeLeavesHasher(const std::wstring& filename, unsigned long long first, size_t count,
+                     unsigned char *hashes)
+        : Thread("WinSparkle tree hasher"),
+          m_filename(filename), m_first(first), m_count(count), m_hashes(hashes),
+          m_succeeded(false)
+    {}
+
+    // Hashes the leaves on the calling thread.
+    void Compute()
+    {
+        // errors are reported by the caller
+        try
+        {
+            CFile f(_wfopen(m_filename.c_str(), L"rb"));
+            if (!f || _fseeki64(f, m_first * TreeHasher::LEAF_SIZE, SEEK_SET) != 0)
+                return;
+
+            std::vector<unsigned char> buffer(TreeHasher::LEAF_SIZE);
+            for (size_t i = 0; i < m_count; i++)
+            {
+                const size_t bytes_read = fread(buffer.data(), 1, buffer.size(), f);
+                if (ferror(f))
+                    return;
+                TreeHasher::HashLeaf(buffer.data(), bytes_read, m_hashes + i * TreeHasher::HASH_SIZE);
+            }
+            m_succeeded = true;
+        }
+        catch ( ... )
+        {
+        }
+    }
 
-    bool ok = false;
+    // Only valid after the leaves were hashed:
+    bool Succeeded() const { return m_succeeded; }
+
+protected:
+    virtual void Run()
+    {
+        SignalReady();
+        Compute();
+    }
+
+    virtual bool IsJoinable() const { return true; }
+
+private:
+    std::wstring m_filename;
+    unsigned long long m_first;
+    size_t m_count;
+    unsigned char *m_hashes;
+    bool m_succeeded;
+};
+
+// Computes the tree hash of the file, hashing its parts in parallel.
+void ComputeFileTreeHash(const std::wstring& filename, unsigned char root[TreeHasher::HASH_SIZE])
+{
+    WIN32_FILE_ATTRIBUTE_DATA attrs;
+    if (!GetFileAttributesExW(filename.c_str(), GetFileExInfoStandard, &attrs))
+        throw std::runtime_error(WideToAnsi(L"Failed to read file " + filename));
+
+    const unsigned long long size = (unsigned long long)attrs.nFileSizeHigh << 32 | attrs.nFileSizeLow;
+    const size_t leaves = (std::max)(size_t((size + TreeHasher::LEAF_SIZE - 1) / TreeHasher::LEAF_SIZE), size_t(1));
+
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    const size_t parts = (std::min)((std::min)(size_t(si.dwNumberOfProcessors), TREE_HASH_MAX_THREADS), leaves);
+
+    std::string hashes(leaves * TreeHasher::HASH_SIZE, '\0');
+    unsigned char *out = reinterpret_cast<unsigned char*>(&hashes[0]);
+
+    std::vector<std::unique_ptr<TreeLeavesHasher>> hashers;
+    for (size_t i = 0; i < parts; i++)
+    {
+        const size_t first = i * leaves / parts;
+        const size_t last = (i + 1) * leaves / parts;
+        hashers.emplace_back(new TreeLeavesHasher(filename, first, last - first,
+                                                  out + first * TreeHasher::HASH_SIZE));
+    }
 
-    if (CryptStringToBinaryA(&base64[0], (DWORD)base64.size(), CRYPT_STRING_BASE64, NULL, &nDestinationSize, NULL, NULL))
+    // the first part is hashed on this thread, as are any others whose
+    // thread couldn't be started
+    std::vector<bool> started(parts, false);
+    for (size_t i = 1; i < parts; i++)
     {
-        bin.resize(nDestinationSize);
-        if (CryptStringToBinaryA(&base64[0], (DWORD)base64.size(), CRYPT_STRING_BASE64, (BYTE *)&bin[0], &nDestinationSize, NULL, NULL))
+        try
         {
-            ok = true;
+            hashers[i]->Start();
+            started[i] = true;
         }
+        catch ( ... )
+        {
+        }
+    }
+
+    for (size_t i = 0; i < parts; i++)
+    {
+        if (!started[i])
+            hashers[i]->Compute();
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < parts; i++)
+    {
+        if (started[i])
+            hashers[i]->Join();
+        ok = ok && hashers[i]->Succeeded();
     }
 
     if (!ok)
-        throw std::runtime_error("Failed to decode base64 string");
+        throw std::runtime_error(WideToAnsi(L"Failed to read file " + filename));
 
-    return bin;
+    TreeHasher::Root(hashes, root);
 }
 
 } // anonynous
 
+// Decoded EdDSA public key, ready to be used for verification.
+struct EdDSAPubKey
+{
+    unsigned char bytes[32];
+
+    // key ID, as used by sparkle:edKeyId
+    std::string id;
+
+    // decompressed and negated point A, as used by verification
+    ge_p3 negA;
+};
+
+namespace
+{
+
+// Decodes and validates EdDSA public key in base64 format.
+std::shared_ptr<const EdDSAPubKey> DecodeEdDSAPubKey(const std::string& pubkey_base64)
+{
+    const std::string bin = Base64Decode(pubkey_base64);
+
+    auto key = std::make_shared<EdDSAPubKey>();
+    if (bin.size() != sizeof(key->bytes))
+    {
+        throw BadSignatureException("Invalid public key size.");
+    }
+
+    memcpy(key->bytes, bin.data(), sizeof(key->bytes));
+    if (ge_frombytes_negate_vartime(&key->negA, key->bytes) != 0)
+        throw BadSignatureException("Invalid public key.");
+
+    // the ID is hex-encoded beginning of the key's SHA-512 hash
+    unsigned char hash[SHA512Hasher::HASH_SIZE];
+    SHA512Hasher::Hash(key->bytes, sizeof(key->bytes), hash);
+    key->id = HashToHex(hash, 8);
+
+    return key;
+}
+
+typedef std::vector<std::shared_ptr<const EdDSAPubKey>> EdDSAPubKeys;
+
+// Most recently used EdDSA public keys, so that they are not decoded again
+// for every verified signature.
+CriticalSection g_csEdDSAPubKeys;
+std::vector<std::string> g_EdDSAPubKeysBase64;
+EdDSAPubKeys g_EdDSAPubKeys;
+
+EdDSAPubKeys GetEdDSAPubKeys()
+{
+    const std::vector<std::string> pubkeys_base64 = Settings::GetEdDSAPubKeys();
+
+    CriticalSectionLocker lock(g_csEdDSAPubKeys);
+    if (g_EdDSAPubKeysBase64 != pubkeys_base64)
+    {
+        EdDSAPubKeys keys;
+        for (auto& k : pubkeys_base64)
+            keys.push_back(DecodeEdDSAPubKey(k));
+
+        g_EdDSAPubKeys.swap(keys);
+        g_EdDSAPubKeysBase64 = pubkeys_base64;
+    }
+    return g_EdDSAPubKeys;
+}
+
+// Passes contents of the file to the verifier.
+void HashFile(const std::wstring& filename, StreamVerifier& verifier)
+{
+    CFile f(_wfopen(filename.c_str(), L"rb"));
+    if (!f || ferror(f))
+        throw std::runtime_error(WideToAnsi(L"Failed to read file " + filename));
+
+    std::vector<unsigned char> buffer(64 * 1024);
+    for (;;)
+    {
+        const size_t bytes_read = fread(buffer.data(), 1, buffer.size(), f);
+        if (ferror(f))
+            throw std::runtime_error(WideToAnsi(L"Failed to read file " + filename));
+        if (bytes_read == 0)
+            break;
+        verifier.Update(buffer.data(), bytes_read);
+    }
+}
+
+} // anonymous namespace
+
 void SignatureVerifier::VerifyDSAPubKeyPem(const std::string &pem)
 {
     // DSAPub::DSAPub() throw if not valid
@@ -298,74 +389,171 @@ void SignatureVerifier::VerifyDSAPubKeyPem(const std::string &pem)
 
 void SignatureVerifier::VerifyEdDSAPubKey(const std::string& pubkey_base64)
 {
-    const std::string pubkey = Base64ToBin(pubkey_base64);
-    if (pubkey.size() != 32)
-    {
-        throw BadSignatureException("Invalid public key size.");
-    }
+    DecodeEdDSAPubKey(pubkey_base64);
 }
 
 void SignatureVerifier::VerifyDSASHA1SignatureValid(const std::wstring &filename, const std::string &signature_base64)
 {
+    DSAStreamVerifier verifier(signature_base64);
     try
     {
-        if (signature_base64.size() == 0)
-            throw BadSignatureException("Missing DSA signature!");
-        TinySSL::inst().VerifyDSASHA1Signature(filename, Base64ToBin(signature_base64));
-    }
-    catch (BadSignatureException&)
-    {
-        throw;
+        HashFile(filename, verifier);
     }
     catch (const std::exception &e)
     {
         throw BadSignatureException(e.what());
     }
-    catch (...)
-    {
-        throw BadSignatureException();
-    }
+    verifier.Verify();
+}
+
+void SignatureVerifier::VerifyEdDSASignatureValid(const std::wstring& filename, const std::string& signature_base64,
+                                                  const std::string& key_id)
+{
+    EdDSAStreamVerifier verifier(signature_base64, key_id);
+    HashFile(filename, verifier);
+    verifier.Verify();
 }
 
-void SignatureVerifier::VerifyEdDSASignatureValid(const std::wstring& filename, const std::string& signature_base64)
+void SignatureVerifier::VerifyEdDSATreeSignatureValid(const std::wstring& filename, const std::string& signature_base64,
+                                                      const std::string& key_id)
+{
+    // check the signature before spending time on hashing
+    EdDSAStreamVerifier verifier(signature_base64, key_id);
+
+    unsigned char root[TreeHasher::HASH_SIZE];
+    ComputeFileTreeHash(filename, root);
+
+    verifier.Update(EDDSA_TREE_CONTEXT, sizeof(EDDSA_TREE_CONTEXT));
+    verifier.Update(root, sizeof(root));
+    verifier.Verify();
+}
+
+EdDSAStreamVerifier::EdDSAStreamVerifier(const std::string& signature_base64, const std::string& key_id)
 {
     if (signature_base64.size() == 0)
         throw BadSignatureException("Missing EdDSA signature!");
 
-    CFile f(_wfopen(filename.c_str(), L"rb"));
-    if (!f || ferror(f))
-        throw std::runtime_error(WideToAnsi(L"Failed to read file " + filename));
+    m_signature = Base64Decode(signature_base64);
+    if (m_signature.size() != 64)
+    {
+        throw BadSignatureException("Invalid signature size.");
+    }
 
-    fseek(f, 0, SEEK_END);
-    long lsize = ftell(f);
-    if (lsize < 0)
-        throw std::runtime_error(WideToAnsi(L"Failed to read file " + filename));
-    size_t size = static_cast<size_t>(lsize);
-    rewind(f);
+    // With a key ID, only that key is used. Otherwise, the signature may be
+    // made with any of the keys and all of them must be tried.
+    for (auto& key : GetEdDSAPubKeys())
+    {
+        if (key_id.empty() || _stricmp(key->id.c_str(), key_id.c_str()) == 0)
+            m_pubkeys.push_back(key);
+    }
 
-    std::vector<unsigned char> payload(size);
-    size_t bytes_read = fread(payload.data(), 1, (size_t)size, f);
-    if (bytes_read != size || ferror(f))
-        throw std::runtime_error(WideToAnsi(L"Failed to read file " + filename));
+    if (m_pubkeys.empty())
+    {
+        if (key_id.empty())
+            throw BadSignatureException("No EdDSA public key.");
+        else
+            throw BadSignatureException("Unknown EdDSA key ID " + key_id + ".");
+    }
 
-    const std::string signature = Base64ToBin(signature_base64);
-    if (signature.size() != 64)
+    // This is ed25519_verify() split into incremental steps: the signed
+    // message is only used as input of SHA-512 hash of R || A || M, which
+    // must be computed for every candidate key.
+    for (auto& key : m_pubkeys)
     {
-        throw BadSignatureException("Invalid signature size.");
+        m_hashes.emplace_back(new SHA512Hasher);
+        m_hashes.back()->Update(m_signature.data(), 32);
+        m_hashes.back()->Update(key->bytes, sizeof(key->bytes));
+    }
+}
+
+EdDSAStreamVerifier::~EdDSAStreamVerifier()
+{
+}
+
+void EdDSAStreamVerifier::Update(const void *data, size_t len)
+{
+    for (auto& hash : m_hashes)
+        hash->Update(data, len);
+}
+
+void EdDSAStreamVerifier::Verify()
+{
+    const unsigned char *signature = reinterpret_cast<const unsigned char*>(m_signature.data());
+
+    if (signature[63] & 224)
+        throw BadSignatureException();
+
+    for (size_t i = 0; i < m_pubkeys.size(); i++)
+    {
+        unsigned char h[SHA512Hasher::HASH_SIZE];
+        m_hashes[i]->Final(h);
+
+        sc_reduce(h);
+
+        ge_p2 R;
+        unsigned char checker[32];
+        ge_double_scalarmult_vartime(&R, h, &m_pubkeys[i]->negA, signature + 32);
+        ge_tobytes(checker, &R);
+
+        if (memcmp(checker, signature, 32) == 0)
+            return;
     }
 
-    const std::string pubkey = Base64ToBin(Settings::GetEdDSAPubKey());
-    if (pubkey.size() != 32)
+    throw BadSignatureException();
+}
+
+struct DSAStreamVerifier::SHA1Context : public SHA_CTX
+{
+};
+
+DSAStreamVerifier::DSAStreamVerifier(const std::string& signature_base64)
+    : m_sha1(new SHA1Context)
+{
+    if (signature_base64.size() == 0)
+        throw BadSignatureException("Missing DSA signature!");
+
+    try
     {
-        throw BadSignatureException("Invalid public key size.");
+        m_signature = Base64Decode(signature_base64);
+    }
+    catch (const std::exception &e)
+    {
+        throw BadSignatureException(e.what());
     }
 
-    int result = ed25519_verify(reinterpret_cast<const unsigned char*>(signature.data()),
-                                payload.data(),
-                                payload.size(),
-                                reinterpret_cast<const unsigned char*>(pubkey.data()));
-    if (result != 1)
+    SHA1_Init(m_sha1.get());
+}
+
+DSAStreamVerifier::~DSAStreamVerifier()
+{
+}
+
+void DSAStreamVerifier::Update(const void *data, size_t len)
+{
+    SHA1_Update(m_sha1.get(), data, len);
+}
+
+void DSAStreamVerifier::Verify()
+{
+    unsigned char sha1[SHA_DIGEST_LENGTH];
+    SHA1_Final(sha1, m_sha1.get());
+
+    try
+    {
+        TinySSL::inst().VerifyDSASHA1Signature(sha1, m_signature);
+    }
+    catch (BadSignatureException&)
+    {
+        throw;
+    }
+    catch (const std::exception &e)
+    {
+        throw BadSignatureException(e.what());
+    }
+    catch (...)
+    {
         throw BadSignatureException();
+    }
 }
 
 } // namespace winsparkle
@@ -26,12 +26,18 @@
 #ifndef _signatureverifier_h_
 #define _signatureverifier_h_
 
+#include "hashes.h"
+
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 namespace winsparkle
 {
 
+struct EdDSAPubKey;
+
 class BadSignatureException : public std::runtime_error
 {
 public:
@@ -45,7 +51,8 @@ public:
     // Throws an exception if pem is not a valid DSA public key in PEM format
     static void VerifyDSAPubKeyPem(const std::string &pem);
 
-    // Throws an exception if pem is not a valid EdDSA public key in base64 format
+    // Throws an exception if pubkey_base64 is not a valid EdDSA public key in
+    // base64 format.
     static void VerifyEdDSAPubKey(const std::string& pubkey_base64);
 
     // Verify DSA signature of SHA1 hash of the file. Equivalent to:
@@ -53,9 +60,80 @@ public:
     // Throws BadSignatureException on failure.
     static void VerifyDSASHA1SignatureValid(const std::wstring &filename, const std::string &signature_base64);
 
-    // Verify EdDSA signature of the file.
+    // Verify EdDSA signature of the file, made by the key with the given ID
+    // or, if key_id is empty, by any of the trusted keys.
+    // Throws BadSignatureException on failure.
+    static void VerifyEdDSASignatureValid(const std::wstring& filename, const std::string& signature_base64,
+                                          const std::string& key_id = std::string());
+
+    // Verify EdDSA tree signature of the file, i.e. signature of its tree
+    // hash (see TreeHasher) prefixed with EDDSA_TREE_CONTEXT. The file is hashed on several threads.
     // Throws BadSignatureException on failure.
-    static void VerifyEdDSASignatureValid(const std::wstring& filename, const std::string& signature_base64);
+    static void VerifyEdDSATreeSignatureValid(const std::wstring& filename, const std::string& signature_base64,
+                                              const std::string& key_id = std::string());
+};
+
+// Verifies signature of data passed to it piece by piece, e.g. as they
+// are being downloaded, without having all of them available at once.
+class StreamVerifier
+{
+public:
+    virtual ~StreamVerifier() {}
+
+    // Add next piece of the signed data.
+    virtual void Update(const void *data, size_t len) = 0;
+
+    // Verify the signature of all data passed to Update().
+    // Throws BadSignatureException on failure.
+    virtual void Verify() = 0;
+};
+
+// Prefix of the message signed by tree signatures, i.e. followed by the tree
+// hash. It includes the terminating NUL and ensures that tree signatures
+// can't be passed off as signatures of update files and vice versa.
+const char EDDSA_TREE_CONTEXT[] = "WinSparkle tree v1";
+
+// Prefix of the message signed by chunk manifest signatures, followed by
+// the manifest, for the same reason.
+const char EDDSA_CHUNK_MANIFEST_CONTEXT[] = "WinSparkle chunk manifest v1";
+
+// Verifies EdDSA signature of data passed to it piece by piece.
+class EdDSAStreamVerifier : public StreamVerifier
+{
+public:
+    // Throws BadSignatureException if the signature or public key is
+    // malformed or if there's no key with the given ID. If key_id is empty,
+    // any of the trusted keys is accepted.
+    EdDSAStreamVerifier(const std::string& signature_base64, const std::string& key_id = std::string());
+    virtual ~EdDSAStreamVerifier();
+
+    virtual void Update(const void *data, size_t len);
+    virtual void Verify();
+
+private:
+    std::string m_signature;
+
+    // candidate keys and SHA-512 hashes for each of them
+    std::vector<std::shared_ptr<const EdDSAPubKey>> m_pubkeys;
+    std::vector<std::unique_ptr<SHA512Hasher>> m_hashes;
+};
+
+// Verifies legacy DSA signature of SHA-1 hash of data passed to it piece by
+// piece.
+class DSAStreamVerifier : public StreamVerifier
+{
+public:
+    // Throws BadSignatureException if the signature is malformed.
+    DSAStreamVerifier(const std::string& signature_base64);
+    virtual ~DSAStreamVerifier();
+
+    virtual void Update(const void *data, size_t len);
+    virtual void Verify();
+
+private:
+    std::string m_signature;
+    struct SHA1Context;
+    std::unique_ptr<SHA1Context> m_sha1;
 };
 
 } // namespace winsparkle
@@ -69,6 +69,18 @@ public:
         return WaitUntilSignaled(0);
     }
 
+    /// Wait until @a a or @a b is signalled; returns the event or NULL on timeout
+    static Event *WaitUntilAnySignaled(Event& a, Event& b, unsigned timeoutMilliseconds = INFINITE)
+    {
+        HANDLE handles[] = { a.m_handle, b.m_handle };
+        switch ( WaitForMultipleObjects(2, handles, FALSE, timeoutMilliseconds) )
+        {
+            case WAIT_OBJECT_0:     return &a;
+            case WAIT_OBJECT_0 + 1: return &b;
+            default:                return NULL;
+        }
+    }
+
 private:
     HANDLE m_handle;
 };
@@ -1127,7 +1127,7 @@ void UpdateDialog::ShowReleaseNotes(const Appcast& info)
     else if ( !info.Description.empty() )
     {
         m_webBrowserState.Reset(WebBrowserSourceInline);
-        m_webBrowser->SetPage(wxString::FromUTF8(info.Description), "");
+        m_webBrowser->SetPage(wxString::FromUTF8(info.Description.Get()), "");
     }
 
     SetWindowStyleFlag(GetWindowStyleFlag() | wxRESIZE_BORDER);
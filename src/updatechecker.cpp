@@ -26,11 +26,14 @@
 
 #include "updatechecker.h"
 #include "appcast.h"
+#include "checkinterval.h"
 #include "ui.h"
 #include "error.h"
 #include "settings.h"
 #include "download.h"
 #include "utils.h"
+#include "notifications.h"
+#include "feedcache.h"
 
 #include <ctime>
 #include <vector>
@@ -116,6 +119,16 @@ vector<string> SplitVersionString(const string& version)
     return list;
 }
 
+// Checks URL given by the appcast. Remote appcasts must not refer to local
+// files: besides not making sense, accessing a file share chosen by the
+// server would authenticate the user to it.
+void CheckAppcastItemURL(const std::string& url, const std::string& purpose, const std::string& appcastURL)
+{
+    if ( IsLocalURL(url) && !IsLocalURL(appcastURL) )
+        throw std::runtime_error("Remote appcast refers to local file (" + purpose + "): " + url);
+    CheckForInsecureURL(url, purpose, appcastURL);
+}
+
 } // anonymous namespace
 
 
@@ -210,6 +223,88 @@ int UpdateChecker::CompareVersions(const string& verA, const string& verB)
 }
 
 
+namespace
+{
+
+// How often to check while connected to the feed's notifications stream,
+// as a safety net in case notifications are lost
+const int NOTIFICATIONS_CHECK_INTERVAL = 60*60*24*7; // one week
+
+// Minimal time between checks triggered by notifications
+const int NOTIFIED_CHECK_DELAY = 60;
+
+// Returns interval between automatic checks, taking adaptive checking into account.
+int GetCheckInterval()
+{
+    const int minInterval = win_sparkle_get_update_check_interval();
+    const int maxInterval = Settings::GetAdaptiveCheckMaxInterval();
+    if ( maxInterval <= minInterval )
+        return minInterval;
+
+    int interval;
+    if ( !Settings::ReadConfigValue("AdaptiveCheckInterval", interval) )
+        return minInterval;
+
+    return (std::min)((std::max)(interval, minInterval), maxInterval);
+}
+
+// Records the feed's state and computes the next adaptive check interval.
+// The state is the feed's fingerprint, see LoadAppcastFeed(), so that any
+// change is noticed, not only a new release.
+void UpdateAdaptiveCheckInterval(const std::string& fingerprint, bool critical)
+{
+    const int maxInterval = Settings::GetAdaptiveCheckMaxInterval();
+    if ( !maxInterval )
+        return;
+
+    std::string lastFingerprint;
+    Settings::ReadConfigValue("LastFeedFingerprint", lastFingerprint);
+    const bool changed = critical || lastFingerprint != fingerprint;
+
+    const int interval = NextCheckInterval(GetCheckInterval(),
+                                           win_sparkle_get_update_check_interval(),
+                                           maxInterval,
+                                           changed);
+    Settings::WriteConfigValue("AdaptiveCheckInterval", interval);
+    Settings::WriteConfigValue("LastFeedFingerprint", fingerprint);
+}
+
+// Same, but relying on notifications if they are available.
+int GetCheckInterval(NotificationListener *listener)
+{
+    const int interval = GetCheckInterval();
+    if ( listener && listener->IsConnected() )
+        return (std::max)(interval, NOTIFICATIONS_CHECK_INTERVAL);
+    return interval;
+}
+
+// Starts or stops the notifications listener to match the feed.
+void UpdateNotificationListener(NotificationListener*& listener, bool enabled)
+{
+    std::string url;
+    if ( enabled )
+        Settings::ReadConfigValue("NotificationURL", url);
+
+    if ( listener && listener->GetURL() == url )
+        return;
+
+    if ( listener )
+    {
+        listener->TerminateAndJoin();
+        delete listener;
+        listener = NULL;
+    }
+
+    if ( !url.empty() )
+    {
+        listener = new NotificationListener(url);
+        listener->Start();
+    }
+}
+
+} // anonymous namespace
+
+
 /*--------------------------------------------------------------------------*
                              UpdateChecker::Run()
  *--------------------------------------------------------------------------*/
@@ -225,15 +320,27 @@ void UpdateChecker::PerformUpdateCheck()
         const std::string url = Settings::GetAppcastURL();
         if ( url.empty() )
             throw std::runtime_error("Appcast URL not specified.");
-        CheckForInsecureURL(url, "appcast feed");
+        CheckForInsecureURL(url, "appcast feed", url);
 
-        StringDownloadSink appcast_xml;
-        DownloadFile(url, &appcast_xml, this, Settings::GetHttpHeadersString(), Download_BypassProxies);
+        AppcastChannel channel;
+        std::string fingerprint;
+        auto all = LoadAppcastFeed(url, this, channel, &fingerprint);
 
-        auto all = Appcast::Load(appcast_xml.data);
+        if ( channel.NotificationURL.empty() )
+        {
+            Settings::DeleteConfigValue("NotificationURL");
+        }
+        else
+        {
+            CheckAppcastItemURL(channel.NotificationURL, "notifications", url);
+            Settings::WriteConfigValue("NotificationURL", channel.NotificationURL);
+        }
 
         if (all.empty())
         {
+            if ( IsScheduled() )
+                UpdateAdaptiveCheckInterval(fingerprint, false);
+
             // No applicable updates in the feed.
             UI::NotifyNoUpdates(ShouldAutomaticallyInstall());
             return;
@@ -246,20 +353,29 @@ void UpdateChecker::PerformUpdateCheck()
             [](const Appcast& a, const Appcast& b) { return CompareVersions(a.Version, b.Version) > 0; }
         );
 
-        auto appcast = all.front();
+        Appcast appcast = std::move(all.front());
 
         if (!appcast.ReleaseNotesURL.empty())
-            CheckForInsecureURL(appcast.ReleaseNotesURL, "release notes");
+            CheckAppcastItemURL(appcast.ReleaseNotesURL, "release notes", url);
         if (!appcast.enclosure.DownloadURL.empty())
-            CheckForInsecureURL(appcast.enclosure.DownloadURL, "update file");
-
-        Settings::WriteConfigValue("LastCheckTime", time(NULL));
+            CheckAppcastItemURL(appcast.enclosure.DownloadURL, "update file", url);
+        for (const auto& mirror : appcast.enclosure.MirrorURLs)
+            CheckAppcastItemURL(mirror, "update file mirror", url);
+        if (!appcast.enclosure.ChunkManifestURL.empty())
+            CheckAppcastItemURL(appcast.enclosure.ChunkManifestURL, "chunk manifest", url);
 
         const std::string currentVersion =
                 WideToAnsi(Settings::GetAppBuildVersion());
+        const bool isNewer =
+                appcast.IsValid() && CompareVersions(currentVersion, appcast.Version) < 0;
+
+        // manual checks don't say anything about how often to check
+        if ( IsScheduled() )
+            UpdateAdaptiveCheckInterval(fingerprint, isNewer && appcast.CriticalUpdate);
+        Settings::WriteConfigValue("LastCheckTime", time(NULL));
 
         // Check if our version is out of date.
-        if ( !appcast.IsValid() || CompareVersions(currentVersion, appcast.Version) >= 0 )
+        if ( !isNewer )
         {
             // The same or newer version is already installed.
             UI::NotifyNoUpdates(ShouldAutomaticallyInstall());
@@ -301,36 +417,70 @@ void PeriodicUpdateChecker::Run()
     // no initialization to do, so signal readiness immediately
     SignalReady();
 
-    while (true)
+    // listens to the feed's notifications, if it has any
+    NotificationListener *listener = NULL;
+    bool notified = false;
+
+    try
     {
-        // time to wait for next iteration: either a reasonable default or
-        // time to next scheduled update check if checks are enabled
-        unsigned sleepTimeInSeconds = 60 * 60; // 1 hour
+        while (true)
+        {
+            // time to wait for next iteration: either a reasonable default or
+            // time to next scheduled update check if checks are enabled
+            unsigned sleepTimeInSeconds = 60 * 60; // 1 hour
 
-        bool checkUpdates;
-        Settings::ReadConfigValue("CheckForUpdates", checkUpdates, false);
+            bool checkUpdates;
+            Settings::ReadConfigValue("CheckForUpdates", checkUpdates, false);
 
-        if (checkUpdates)
-        {
-            const time_t currentTime = time(NULL);
-            time_t lastCheck = 0;
-            Settings::ReadConfigValue("LastCheckTime", lastCheck);
-
-            // Only check for updates in reasonable intervals:
-            const int interval = win_sparkle_get_update_check_interval();
-            time_t nextCheck = lastCheck + interval;
-            if (currentTime >= nextCheck)
+            UpdateNotificationListener(listener, checkUpdates);
+
+            if (checkUpdates)
+            {
+                const time_t currentTime = time(NULL);
+                time_t lastCheck = 0;
+                Settings::ReadConfigValue("LastCheckTime", lastCheck);
+
+                // Only check for updates in reasonable intervals, unless
+                // a new release was announced:
+                const int interval = notified ? NOTIFIED_CHECK_DELAY
+                                              : GetCheckInterval(listener);
+                time_t nextCheck = lastCheck + interval;
+                if (currentTime >= nextCheck)
+                {
+                    notified = false;
+                    PerformUpdateCheck();
+                    UpdateNotificationListener(listener, checkUpdates);
+                    sleepTimeInSeconds = GetCheckInterval(listener);
+                }
+                else
+                {
+                    sleepTimeInSeconds = unsigned(nextCheck - currentTime);
+                }
+            }
+
+            // adaptive intervals can be long; wake up at least daily to
+            // avoid overflowing the timeout and to notice settings changes
+            sleepTimeInSeconds = (std::min)(sleepTimeInSeconds, 60u * 60 * 24);
+
+            if (listener)
             {
-                PerformUpdateCheck();
-                sleepTimeInSeconds = interval;
+                Event& notification = listener->GetNotificationEvent();
+                if (Event::WaitUntilAnySignaled(m_terminateEvent, notification,
+                                                sleepTimeInSeconds * 1000) == &notification)
+                {
+                    notified = true;
+                }
             }
             else
             {
-                sleepTimeInSeconds = unsigned(nextCheck - currentTime);
+                m_terminateEvent.WaitUntilSignaled(sleepTimeInSeconds * 1000);
             }
         }
-
-        m_terminateEvent.WaitUntilSignaled(sleepTimeInSeconds * 1000);
+    }
+    catch ( ... )
+    {
+        UpdateNotificationListener(listener, false);
+        throw;
     }
 }
 
@@ -66,6 +66,9 @@ protected:
     /// Should we install the update or prompt the user for options first?
     virtual bool ShouldAutomaticallyInstall() const { return false; }
 
+    /// Is this a scheduled automatic check (rather than e.g. a manual one)?
+    virtual bool IsScheduled() const { return false; }
+
 protected:
     virtual void PerformUpdateCheck();
     virtual bool IsJoinable() const { return false; }
@@ -77,6 +80,7 @@ class PeriodicUpdateChecker : public UpdateChecker
 {
 protected:
     virtual void Run();
+    virtual bool IsScheduled() const { return true; }
 };
 
 
@@ -25,7 +25,11 @@
 
 #include "appcontroller.h"
 #include "updatedownloader.h"
+#include "decompress.h"
 #include "download.h"
+#include "filewriter.h"
+#include "hashes.h"
+#include "mirrors.h"
 #include "settings.h"
 #include "ui.h"
 #include "error.h"
@@ -33,8 +37,11 @@
 
 #include <wx/string.h>
 
+#include <algorithm>
+#include <memory>
 #include <sstream>
 #include <rpc.h>
+#include <shlwapi.h>
 #include <time.h>
 
 namespace winsparkle
@@ -85,22 +92,75 @@ std::wstring CreateUniqueTempDirectory()
     }
 }
 
+// Progress callback for CopyFileEx() used by StageLocalFile()
+DWORD CALLBACK CopyProgressRoutine(LARGE_INTEGER total, LARGE_INTEGER transferred,
+                                   LARGE_INTEGER, LARGE_INTEGER, DWORD, DWORD,
+                                   HANDLE, HANDLE, LPVOID data)
+{
+    Thread& thread = *static_cast<Thread*>(data);
+    try
+    {
+        thread.CheckShouldTerminate();
+    }
+    catch ( ... )
+    {
+        return PROGRESS_CANCEL;
+    }
+
+    UI::NotifyDownloadProgress(size_t(transferred.QuadPart), size_t(total.QuadPart));
+    return PROGRESS_CONTINUE;
+}
+
+// Puts a local update file (e.g. on a file share) into the temporary
+// directory. Instead of reading it through a sink, it is copied by the OS,
+// which can offload the copy to the storage if it supports it. It is always
+// copied, never linked, so that the file whose signature is verified can't
+// be modified by anyone who can write to the source.
+std::wstring StageLocalFile(const std::wstring& source, const std::wstring& dir, Thread& thread)
+{
+    const std::wstring target = dir + L"\\" + PathFindFileNameW(source.c_str());
+
+    BOOL cancel = FALSE;
+    if ( !CopyFileExW(source.c_str(), target.c_str(), &CopyProgressRoutine, &thread, &cancel, 0) )
+    {
+        thread.CheckShouldTerminate(); // in case the copy was cancelled
+        throw Win32Exception("Cannot copy update file");
+    }
+
+    return target;
+}
+
+// Saves downloaded data into a file in the given directory.
 struct UpdateDownloadSink : public IDownloadSink
 {
     UpdateDownloadSink(Thread& thread, const std::wstring& dir)
-        : m_thread(thread),
-          m_dir(dir), m_file(NULL),
-          m_downloaded(0), m_total(0), m_lastUpdate(-1)
+        : m_thread(thread), m_dir(dir), m_file(INVALID_HANDLE_VALUE), m_writer(NULL), m_total(0)
     {}
 
-    ~UpdateDownloadSink() { Close(); }
+    ~UpdateDownloadSink()
+    {
+        // Close() wasn't called, which only happens on errors: there's no
+        // point in writing out remaining data, just close the file
+        delete m_writer;
+        if ( m_file != INVALID_HANDLE_VALUE )
+            CloseHandle(m_file);
+    }
 
     void Close()
     {
-        if ( m_file )
+        if ( m_file != INVALID_HANDLE_VALUE )
         {
-            fclose(m_file);
-            m_file = NULL;
+            m_writer->Finish();
+            delete m_writer;
+            m_writer = NULL;
+
+            // the file was preallocated to the announced size, make sure it
+            // doesn't end with garbage if less data arrived:
+            if ( !SetEndOfFile(m_file) )
+                throw Win32Exception("Cannot save update file");
+
+            CloseHandle(m_file);
+            m_file = INVALID_HANDLE_VALUE;
         }
     }
 
@@ -110,24 +170,106 @@ struct UpdateDownloadSink : public IDownloadSink
 
     virtual void SetFilename(const std::wstring& filename)
     {
-        if ( m_file )
+        if ( m_file != INVALID_HANDLE_VALUE )
             throw std::runtime_error("Update file already set");
 
         m_path = m_dir + L"\\" + filename;
-        m_file = _wfopen(m_path.c_str(), L"wb");
-        if ( !m_file )
-            throw std::runtime_error("Cannot save update file");
+        m_file = CreateFileW(m_path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if ( m_file == INVALID_HANDLE_VALUE )
+            throw Win32Exception("Cannot save update file");
+
+        // If the size is known, allocate the whole file upfront. This avoids
+        // fragmentation and repeated file size updates and if there's not
+        // enough disk space, we know immediately.
+        if ( m_total )
+        {
+            LARGE_INTEGER pos;
+            pos.QuadPart = m_total;
+            if ( !SetFilePointerEx(m_file, pos, NULL, FILE_BEGIN) || !SetEndOfFile(m_file) )
+                throw Win32Exception("Cannot save update file");
+            pos.QuadPart = 0;
+            if ( !SetFilePointerEx(m_file, pos, NULL, FILE_BEGIN) )
+                throw Win32Exception("Cannot save update file");
+        }
+
+        m_writer = new BackgroundFileWriter(m_file, &m_thread);
     }
 
     virtual void Add(const void *data, size_t len)
     {
-        if ( !m_file )
-            throw std::runtime_error("Filename is not net");
+        CheckFileSet();
+        m_writer->Write(data, len);
+    }
+
+    virtual void *AcquireBuffer(size_t minLen, size_t& len)
+    {
+        CheckFileSet();
+        return m_writer->AcquireBuffer(minLen, len);
+    }
+
+    virtual void CommitBuffer(size_t len)
+    {
+        m_writer->CommitBuffer(len);
+    }
+
+private:
+    void CheckFileSet()
+    {
+        if ( !m_writer )
+            throw std::runtime_error("Filename is not set");
+    }
+
+    Thread& m_thread;
+    std::wstring m_dir;
+    std::wstring m_path;
+    HANDLE m_file;
+    BackgroundFileWriter *m_writer;
+    size_t m_total;
+};
+
+// Passes data to another sink, reporting download progress and checking
+// for thread termination.
+struct ProgressReportingSink : public IDownloadSink
+{
+    ProgressReportingSink(Thread& thread, IDownloadSink& target)
+        : m_thread(thread), m_target(target),
+          m_downloaded(0), m_total(0), m_lastUpdate(-1)
+    {}
+
+    virtual void SetLength(size_t l)
+    {
+        m_total = l;
+        m_target.SetLength(l);
+    }
 
+    virtual void SetFilename(const std::wstring& filename)
+    {
+        m_target.SetFilename(filename);
+    }
+
+    virtual void Add(const void *data, size_t len)
+    {
         m_thread.CheckShouldTerminate();
+        m_target.Add(data, len);
+        OnDataAdded(len);
+    }
+
+    virtual void *AcquireBuffer(size_t minLen, size_t& len)
+    {
+        m_thread.CheckShouldTerminate();
+        return m_target.AcquireBuffer(minLen, len);
+    }
 
-        if ( fwrite(data, len, 1, m_file) != 1 )
-            throw std::runtime_error("Cannot save update file");
+    virtual void CommitBuffer(size_t len)
+    {
+        m_target.CommitBuffer(len);
+        OnDataAdded(len);
+    }
+
+private:
+    void OnDataAdded(size_t len)
+    {
         m_downloaded += len;
 
         // only update at most 10 times/sec so that we don't flood the UI:
@@ -141,13 +283,330 @@ struct UpdateDownloadSink : public IDownloadSink
     }
 
     Thread& m_thread;
+    IDownloadSink& m_target;
     size_t m_downloaded, m_total;
-    FILE *m_file;
-    std::wstring m_dir;
-    std::wstring m_path;
     clock_t m_lastUpdate;
 };
 
+// Passes data to another sink, verifying their signature on the way.
+struct SignatureVerifyingSink : public IDownloadSink
+{
+    SignatureVerifyingSink(IDownloadSink& target, std::unique_ptr<StreamVerifier> verifier)
+        : m_target(target), m_verifier(std::move(verifier)), m_acquired(NULL)
+    {}
+
+    virtual void SetLength(size_t l) { m_target.SetLength(l); }
+
+    virtual void SetFilename(const std::wstring& filename) { m_target.SetFilename(filename); }
+
+    virtual void Add(const void *data, size_t len)
+    {
+        m_verifier->Update(data, len);
+        m_target.Add(data, len);
+    }
+
+    virtual void *AcquireBuffer(size_t minLen, size_t& len)
+    {
+        m_acquired = m_target.AcquireBuffer(minLen, len);
+        return m_acquired;
+    }
+
+    virtual void CommitBuffer(size_t len)
+    {
+        m_verifier->Update(m_acquired, len);
+        m_target.CommitBuffer(len);
+    }
+
+    void Verify() { m_verifier->Verify(); }
+
+private:
+    IDownloadSink& m_target;
+    std::unique_ptr<StreamVerifier> m_verifier;
+    void *m_acquired;
+};
+
+// Passes data to another sink, checking that they have the length and
+// SHA-256 digest announced in the appcast. Excess data are rejected
+// immediately, the rest is checked by Finish().
+struct DigestCheckingSink : public IDownloadSink
+{
+    DigestCheckingSink(IDownloadSink& target, const Appcast::Enclosure& enclosure)
+        : m_target(target),
+          m_expectedLength(enclosure.Length), m_expectedDigest(enclosure.Sha256),
+          m_received(0), m_acquired(NULL)
+    {}
+
+    virtual void SetLength(size_t l) { m_target.SetLength(l); }
+
+    virtual void SetFilename(const std::wstring& filename) { m_target.SetFilename(filename); }
+
+    virtual void Add(const void *data, size_t len)
+    {
+        OnData(data, len);
+        m_target.Add(data, len);
+    }
+
+    virtual void *AcquireBuffer(size_t minLen, size_t& len)
+    {
+        m_acquired = m_target.AcquireBuffer(minLen, len);
+        return m_acquired;
+    }
+
+    virtual void CommitBuffer(size_t len)
+    {
+        OnData(m_acquired, len);
+        m_target.CommitBuffer(len);
+    }
+
+    // Checks the data once all of them were received. Returns their digest.
+    std::string Finish()
+    {
+        unsigned char digest[SHA256Hasher::HASH_SIZE];
+        m_hasher.Final(digest);
+        const std::string hex = HashToHex(digest, sizeof(digest));
+
+        if ( m_expectedLength && m_received != m_expectedLength )
+            throw std::runtime_error("Downloaded update file has unexpected size.");
+        if ( _stricmp(hex.c_str(), m_expectedDigest.c_str()) != 0 )
+            throw std::runtime_error("Downloaded update file is corrupted (SHA-256 mismatch).");
+
+        return hex;
+    }
+
+private:
+    void OnData(const void *data, size_t len)
+    {
+        m_received += len;
+        if ( m_expectedLength && m_received > m_expectedLength )
+            throw std::runtime_error("Downloaded update file is larger than expected.");
+        m_hasher.Update(data, len);
+    }
+
+    IDownloadSink& m_target;
+    uint64_t m_expectedLength;
+    std::string m_expectedDigest;
+    uint64_t m_received;
+    void *m_acquired;
+    SHA256Hasher m_hasher;
+};
+
+// Digests of consecutive chunks of a file, from its chunk manifest.
+struct ChunkManifest
+{
+    size_t chunkSize;
+    size_t length;
+
+    // SHA-256 digests of the chunks, concatenated
+    std::string digests;
+};
+
+int HexDigitValue(char c)
+{
+    if ( c >= '0' && c <= '9' )
+        return c - '0';
+    if ( c >= 'a' && c <= 'f' )
+        return c - 'a' + 10;
+    if ( c >= 'A' && c <= 'F' )
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Parses the chunk manifest, a text file with the size of the chunks, the
+// size of the whole file and hex-encoded SHA-256 digests of the chunks, one
+// per line:
+//
+//   chunk-size 1048576
+//   length 5000000
+//   9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08
+//   ...
+ChunkManifest ParseChunkManifest(const std::string& data)
+{
+    const std::runtime_error invalid("Invalid chunk manifest.");
+
+    std::istringstream in(data);
+    std::string line;
+    unsigned long long chunkSize = 0, length = 0;
+
+    if ( !std::getline(in, line) || sscanf(line.c_str(), "chunk-size %llu", &chunkSize) != 1 )
+        throw invalid;
+    if ( !std::getline(in, line) || sscanf(line.c_str(), "length %llu", &length) != 1 )
+        throw invalid;
+
+    // be reasonable about memory needed for buffering a chunk
+    if ( chunkSize < 4096 || chunkSize > 64 * 1024 * 1024 || length > SIZE_MAX )
+        throw invalid;
+
+    ChunkManifest manifest;
+    manifest.chunkSize = size_t(chunkSize);
+    manifest.length = size_t(length);
+
+    const size_t count = (manifest.length + manifest.chunkSize - 1) / manifest.chunkSize;
+    manifest.digests.reserve(count * SHA256Hasher::HASH_SIZE);
+
+    while ( std::getline(in, line) )
+    {
+        if ( !line.empty() && line.back() == '\r' )
+            line.pop_back();
+        if ( line.empty() )
+            continue;
+        if ( line.size() != 2 * SHA256Hasher::HASH_SIZE )
+            throw invalid;
+
+        for ( size_t i = 0; i < line.size(); i += 2 )
+        {
+            const int hi = HexDigitValue(line[i]);
+            const int lo = HexDigitValue(line[i + 1]);
+            if ( hi < 0 || lo < 0 )
+                throw invalid;
+            manifest.digests += char(hi << 4 | lo);
+        }
+    }
+
+    if ( manifest.digests.size() != count * SHA256Hasher::HASH_SIZE )
+        throw invalid;
+
+    return manifest;
+}
+
+// Downloads the chunk manifest of the enclosure and checks its signature.
+// Throws BadSignatureException if the manifest isn't properly signed.
+ChunkManifest LoadChunkManifest(const Appcast::Enclosure& enclosure, Thread& thread)
+{
+    StringDownloadSink sink;
+    DownloadFile(enclosure.ChunkManifestURL, &sink, &thread, Settings::GetHttpHeadersString());
+
+    EdDSAStreamVerifier verifier(enclosure.ChunkManifestSignature, enclosure.EdKeyId);
+    verifier.Update(EDDSA_CHUNK_MANIFEST_CONTEXT, sizeof(EDDSA_CHUNK_MANIFEST_CONTEXT));
+    verifier.Update(sink.data.data(), sink.data.size());
+    verifier.Verify();
+
+    ChunkManifest manifest = ParseChunkManifest(sink.data);
+    if ( enclosure.Length && enclosure.Length != manifest.length )
+        throw std::runtime_error("Chunk manifest doesn't match the update file.");
+    return manifest;
+}
+
+// Passes data to another sink one chunk at a time, only after checking that
+// the chunk's digest matches the manifest. Damaged chunks are discarded and
+// reported with CorruptedDataException, so that only they are downloaded
+// again.
+struct ChunkVerifyingSink : public IDownloadSink
+{
+    ChunkVerifyingSink(IDownloadSink& target, const ChunkManifest& manifest)
+        : m_target(target), m_manifest(manifest),
+          m_buffer(new char[manifest.chunkSize]), m_used(0), m_verified(0)
+    {}
+
+    virtual void SetLength(size_t l) { m_target.SetLength(l); }
+
+    virtual void SetFilename(const std::wstring& filename) { m_target.SetFilename(filename); }
+
+    virtual void Add(const void *data, size_t len)
+    {
+        const char *p = static_cast<const char*>(data);
+        while ( len )
+        {
+            const size_t n = (std::min)(len, GetFreeSpace());
+            if ( n == 0 )
+                throw std::runtime_error("Downloaded update file is larger than expected.");
+            memcpy(m_buffer.get() + m_used, p, n);
+            p += n;
+            len -= n;
+            OnDataAdded(n);
+        }
+    }
+
+    virtual void *AcquireBuffer(size_t minLen, size_t& len)
+    {
+        // Once all of the file was received, there's no space left; excess
+        // data, if any, are then passed to Add(), which rejects them.
+        len = GetFreeSpace();
+        if ( len == 0 || len < minLen )
+            return NULL;
+        return m_buffer.get() + m_used;
+    }
+
+    virtual void CommitBuffer(size_t len)
+    {
+        if ( len > GetFreeSpace() )
+            throw std::runtime_error("Downloaded update file is larger than expected.");
+        OnDataAdded(len);
+    }
+
+    // Checks that all of the file was received.
+    void Finish()
+    {
+        if ( m_verified != m_manifest.length )
+            throw std::runtime_error("Downloaded update file has unexpected size.");
+    }
+
+private:
+    // Space left in the current chunk; 0 if all of the file was received.
+    size_t GetFreeSpace() const
+    {
+        return (std::min)(m_manifest.chunkSize, m_manifest.length - m_verified) - m_used;
+    }
+
+    void OnDataAdded(size_t len)
+    {
+        m_used += len;
+        if ( m_used == (std::min)(m_manifest.chunkSize, m_manifest.length - m_verified) )
+            VerifyChunk();
+    }
+
+    void VerifyChunk()
+    {
+        unsigned char digest[SHA256Hasher::HASH_SIZE];
+        SHA256Hasher hasher;
+        hasher.Update(m_buffer.get(), m_used);
+        hasher.Final(digest);
+
+        const size_t index = m_verified / m_manifest.chunkSize;
+        if ( memcmp(digest, m_manifest.digests.data() + index * sizeof(digest), sizeof(digest)) != 0 )
+        {
+            m_used = 0;
+            throw CorruptedDataException("Downloaded data are corrupted at offset " +
+                                         std::to_string((unsigned long long)m_verified) + ".",
+                                         m_verified);
+        }
+
+        m_target.Add(m_buffer.get(), m_used);
+        m_verified += m_used;
+        m_used = 0;
+    }
+
+    IDownloadSink& m_target;
+    const ChunkManifest& m_manifest;
+    std::unique_ptr<char[]> m_buffer;
+    size_t m_used;      // size of the chunk being received
+    size_t m_verified;  // size of the data passed to the target
+};
+
+// Identifies a file whose EdDSA signature was successfully verified with the
+// current public keys. It's computed from the digest of the downloaded data,
+// not the one announced by the appcast, so it can't be forged by the feed.
+std::string GetVerifiedDigestKey(const std::string& digest, const std::string& signature)
+{
+    SHA256Hasher hasher;
+    hasher.Update(digest.data(), digest.size() + 1);
+    hasher.Update(signature.data(), signature.size() + 1);
+    for (auto& pubkey : Settings::GetEdDSAPubKeys())
+        hasher.Update(pubkey.data(), pubkey.size() + 1);
+
+    unsigned char key[SHA256Hasher::HASH_SIZE];
+    hasher.Final(key);
+    return HashToHex(key, sizeof(key));
+}
+
+// Was the same file verified before, e.g. when the update was downloaded
+// but not installed?
+bool WasSignatureVerified(const std::string& digest, const std::string& signature)
+{
+    std::string verified;
+    return Settings::ReadConfigValue("VerifiedUpdateDigest", verified) &&
+           verified == GetVerifiedDigestKey(digest, signature);
+}
+
 } // anonymous namespace
 
 
@@ -176,18 +635,133 @@ void UpdateDownloader::Run()
       const std::wstring tmpdir = CreateUniqueTempDirectory();
       Settings::WriteConfigValue("UpdateTempDir", tmpdir);
 
+      const Appcast::Enclosure& enclosure = m_appcast.enclosure;
+
+      // Downloaded data pass through a chain of sinks, from the last one
+      // constructed to the file:
       UpdateDownloadSink sink(*this, tmpdir);
-      DownloadFile(m_appcast.enclosure.DownloadURL, &sink, this, Settings::GetHttpHeadersString());
-      sink.Close();
+      std::unique_ptr<DecompressingDownloadSink> decompressor;
+      std::unique_ptr<SignatureVerifyingSink> verifyingSink;
+      std::unique_ptr<DigestCheckingSink> digestChecker;
+      std::unique_ptr<ChunkVerifyingSink> chunkVerifier;
+      ChunkManifest manifest;
+      std::string digest;
+      std::wstring filePath;
+
+      const bool useDSA = !Settings::HasEdDSAPubKey() && Settings::HasDSAPubKeyPem();
+      if (useDSA)
+          LogWarning("Using deprecated DSA signature. Please update your app to use EdDSA.");
 
-      if (Settings::HasEdDSAPubKey())
+      const std::wstring localPath = GetLocalPathFromURL(enclosure.DownloadURL);
+      if (!localPath.empty() && enclosure.Compression.empty() && enclosure.MirrorURLs.empty())
       {
-          SignatureVerifier::VerifyEdDSASignatureValid(sink.GetFilePath(), m_appcast.enclosure.EdDsaSignature);
+          filePath = StageLocalFile(localPath, tmpdir, *this);
       }
-      else if (Settings::HasDSAPubKeyPem())
+      else
       {
-          LogWarning("Using deprecated DSA signature. Please update your app to use EdDSA.");
-          SignatureVerifier::VerifyDSASHA1SignatureValid(sink.GetFilePath(), m_appcast.enclosure.DsaSignature);
+          IDownloadSink *chain = &sink;
+          const bool signedCompressed = !enclosure.Compression.empty() && enclosure.SignatureOfCompressedData;
+
+          // DSA signatures are verified while saving the file, so that it
+          // doesn't have to be read again
+          if (useDSA && !signedCompressed)
+          {
+              verifyingSink.reset(new SignatureVerifyingSink(*chain,
+                  std::unique_ptr<StreamVerifier>(new DSAStreamVerifier(enclosure.DsaSignature))));
+              chain = verifyingSink.get();
+          }
+
+          if (!enclosure.Compression.empty())
+          {
+              decompressor.reset(new DecompressingDownloadSink(*chain, enclosure.Compression,
+                                                                enclosure.DecompressedLength));
+              chain = decompressor.get();
+          }
+
+          // signature of compressed data must be checked before decompression,
+          // because they are never saved
+          if (signedCompressed && (Settings::HasEdDSAPubKey() || useDSA))
+          {
+              std::unique_ptr<StreamVerifier> verifier;
+              if (useDSA)
+                  verifier.reset(new DSAStreamVerifier(enclosure.DsaSignature));
+              else
+                  verifier.reset(new EdDSAStreamVerifier(enclosure.EdDsaSignature, enclosure.EdKeyId));
+              verifyingSink.reset(new SignatureVerifyingSink(*chain, std::move(verifier)));
+              chain = verifyingSink.get();
+          }
+
+          // check the digest first, corrupted data are best caught early
+          if (!enclosure.Sha256.empty())
+          {
+              digestChecker.reset(new DigestCheckingSink(*chain, enclosure));
+              chain = digestChecker.get();
+          }
+
+          // use the fastest mirror, falling back to the others if it fails
+          std::vector<std::string> urls(1, enclosure.DownloadURL);
+          urls.insert(urls.end(), enclosure.MirrorURLs.begin(), enclosure.MirrorURLs.end());
+          urls = RankMirrorsByLatency(urls, this, Settings::GetHttpHeadersString());
+
+          ProgressReportingSink progress(*this, *chain);
+          chain = &progress;
+
+          // chunks must be verified before anything else can see them; if
+          // the manifest isn't available, the download is still possible,
+          // just without the ability to recover from corrupted data
+          if (!enclosure.ChunkManifestURL.empty() && Settings::HasEdDSAPubKey())
+          {
+              try
+              {
+                  manifest = LoadChunkManifest(enclosure, *this);
+                  chunkVerifier.reset(new ChunkVerifyingSink(*chain, manifest));
+                  chain = chunkVerifier.get();
+              }
+              catch (BadSignatureException&)
+              {
+                  throw;
+              }
+              catch (std::runtime_error& e)
+              {
+                  LogError(std::string("Cannot use chunk manifest: ") + e.what());
+              }
+          }
+
+          DownloadFileWithFailover(urls, chain, this, Settings::GetHttpHeadersString());
+          if (chunkVerifier)
+              chunkVerifier->Finish();
+          if (digestChecker)
+              digest = digestChecker->Finish();
+          if (decompressor)
+              decompressor->Finish();
+          sink.Close();
+          filePath = sink.GetFilePath();
+      }
+
+      const std::string& signature = enclosure.EdDsaTreeSignature.empty()
+                                     ? enclosure.EdDsaSignature
+                                     : enclosure.EdDsaTreeSignature;
+
+      if (verifyingSink)
+      {
+          verifyingSink->Verify();
+      }
+      else if (Settings::HasEdDSAPubKey())
+      {
+          // verifying the signature needs another pass over the file, which
+          // can be skipped if exactly this file was verified already
+          if (digest.empty() || !WasSignatureVerified(digest, signature))
+          {
+              // tree signatures are faster to verify, prefer them
+              if (!enclosure.EdDsaTreeSignature.empty())
+                  SignatureVerifier::VerifyEdDSATreeSignatureValid(filePath, signature, enclosure.EdKeyId);
+              else
+                  SignatureVerifier::VerifyEdDSASignatureValid(filePath, signature, enclosure.EdKeyId);
+          }
+      }
+      else if (useDSA)
+      {
+          SignatureVerifier::VerifyDSASHA1SignatureValid(filePath, enclosure.DsaSignature);
       }
       else
       {
@@ -195,7 +769,10 @@ void UpdateDownloader::Run()
           LogError("Using unsigned updates!");
       }
 
-      UI::NotifyUpdateDownloaded(sink.GetFilePath(), m_appcast);
+      if (!digest.empty() && Settings::HasEdDSAPubKey())
+          Settings::WriteConfigValue("VerifiedUpdateDigest", GetVerifiedDigestKey(digest, signature));
+
+      UI::NotifyUpdateDownloaded(filePath, m_appcast);
     }
     catch (BadSignatureException&)
     {
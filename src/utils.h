@@ -115,9 +115,20 @@ inline T* LoadDynamicFunc(const char *func, const char *dll)
     LoadDynamicFunc<decltype(func)>(#func, #dll)
 
 
-// Check for insecure URLs
-inline bool CheckForInsecureURL(const std::string& url, const std::string& purpose)
+// Is the URL a local file, including files on file shares?
+inline bool IsLocalURL(const std::string& url)
 {
+    return _strnicmp(url.c_str(), "file:", 5) == 0 || url.compare(0, 2, "\\\\") == 0;
+}
+
+// Check for insecure URLs. Local files, including those on file shares, are
+// fine too, but only if the appcast (whose URL is @a appcastURL) is local:
+// the app itself then points WinSparkle to them, not a remote server.
+inline bool CheckForInsecureURL(const std::string& url, const std::string& purpose, const std::string& appcastURL)
+{
+    if (IsLocalURL(url) && IsLocalURL(appcastURL))
+        return true;
+
     if (url.compare(0, 8, "https://") != 0)
     {
         LogError("----------------------------");
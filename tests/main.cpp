@@ -0,0 +1,100 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "testing.h"
+
+#include <stdio.h>
+#include <vector>
+
+namespace testing
+{
+
+namespace
+{
+
+struct Test
+{
+    const char *name;
+    TestFunction func;
+};
+
+// function-local static, so that it's initialized before any registration
+std::vector<Test>& GetTests()
+{
+    static std::vector<Test> tests;
+    return tests;
+}
+
+struct TestFailure
+{
+    std::string message;
+};
+
+} // anonymous namespace
+
+
+TestRegistration::TestRegistration(const char *name, TestFunction func)
+{
+    Test test = { name, func };
+    GetTests().push_back(test);
+}
+
+
+void Fail(const char *file, int line, const std::string& what)
+{
+    TestFailure failure;
+    failure.message = std::string(file) + ":" + std::to_string(line) + ": check failed: " + what;
+    throw failure;
+}
+
+} // namespace testing
+
+
+int main()
+{
+    using namespace testing;
+
+    unsigned failed = 0;
+    for ( const Test& test : GetTests() )
+    {
+        try
+        {
+            test.func();
+            continue;
+        }
+        catch ( TestFailure& e )
+        {
+            printf("FAILED %s\n  %s\n", test.name, e.message.c_str());
+        }
+        catch ( std::exception& e )
+        {
+            printf("FAILED %s\n  unexpected exception: %s\n", test.name, e.what());
+        }
+        failed++;
+    }
+
+    printf("%u of %u tests passed\n", unsigned(GetTests().size() - failed), unsigned(GetTests().size()));
+    return failed ? 1 : 0;
+}
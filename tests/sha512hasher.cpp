@@ -0,0 +1,68 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "hashes.h"
+
+#include <stdexcept>
+
+// SHA512Hasher uses Windows' CNG if available, which isn't the case here;
+// this implementation only uses the portable fallback from the ed25519
+// library, which produces identical output.
+
+namespace winsparkle
+{
+
+SHA512Hasher::SHA512Hasher() : m_cngHash(NULL)
+{
+    if ( sha512_init(&m_fallback) != 0 )
+        throw std::runtime_error("Failed to initialize SHA-512.");
+}
+
+
+SHA512Hasher::~SHA512Hasher()
+{
+}
+
+
+void SHA512Hasher::Update(const void *data, size_t len)
+{
+    sha512_update(&m_fallback, static_cast<const unsigned char*>(data), len);
+}
+
+
+void SHA512Hasher::Final(unsigned char hash[HASH_SIZE])
+{
+    sha512_final(&m_fallback, hash);
+}
+
+
+/*static*/ void SHA512Hasher::Hash(const void *data, size_t len, unsigned char hash[HASH_SIZE])
+{
+    SHA512Hasher hasher;
+    hasher.Update(data, len);
+    hasher.Final(hash);
+}
+
+} // namespace winsparkle
@@ -0,0 +1,89 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "testing.h"
+#include "base64.h"
+
+using namespace winsparkle;
+
+namespace
+{
+
+std::string Encode(const std::string& data)
+{
+    return Base64Encode(data.data(), data.size());
+}
+
+} // anonymous namespace
+
+
+TEST(base64_rfc4648_vectors)
+{
+    const char *vectors[][2] =
+    {
+        { "",       ""         },
+        { "f",      "Zg=="     },
+        { "fo",     "Zm8="     },
+        { "foo",    "Zm9v"     },
+        { "foob",   "Zm9vYg==" },
+        { "fooba",  "Zm9vYmE=" },
+        { "foobar", "Zm9vYmFy" }
+    };
+
+    for ( const auto& v : vectors )
+    {
+        CHECK(Encode(v[0]) == v[1]);
+        CHECK(Base64Decode(v[1]) == v[0]);
+    }
+}
+
+TEST(base64_round_trip)
+{
+    std::string data;
+    for ( unsigned len = 0; len < 300; len++ )
+    {
+        CHECK(Base64Decode(Encode(data)) == data);
+        data += char(len * 37 + 11);
+    }
+}
+
+TEST(base64_whitespace)
+{
+    CHECK(Base64Decode(" Zm9v\r\nYmFy\t") == "foobar");
+    CHECK(Base64Decode("Zm9vYg=\n=") == "foob");
+}
+
+TEST(base64_invalid)
+{
+    CHECK_THROWS(Base64Decode("Zm9v!"));
+    CHECK_THROWS(Base64Decode("Zm9vY"));      // incomplete quantum
+    CHECK_THROWS(Base64Decode("Zm9vYg"));     // missing padding
+    CHECK_THROWS(Base64Decode("Zm9vYg="));
+    CHECK_THROWS(Base64Decode("Zg==="));      // too much padding
+    CHECK_THROWS(Base64Decode("Zg==Zg=="));   // padding in the middle
+    CHECK_THROWS(Base64Decode("="));
+    CHECK_THROWS(Base64Decode("Zh=="));       // non-zero unused bits
+    CHECK_THROWS(Base64Decode("Zm9="));
+}
@@ -0,0 +1,79 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "testing.h"
+#include "checkinterval.h"
+
+#include <limits.h>
+
+using namespace winsparkle;
+
+namespace
+{
+
+const int HOUR = 60 * 60;
+const int DAY = 24 * HOUR;
+
+} // anonymous namespace
+
+
+TEST(check_interval_doubles_while_unchanged)
+{
+    CHECK(NextCheckInterval(HOUR, HOUR, DAY, false) == 2 * HOUR);
+    CHECK(NextCheckInterval(2 * HOUR, HOUR, DAY, false) == 4 * HOUR);
+    CHECK(NextCheckInterval(8 * HOUR, HOUR, DAY, false) == 16 * HOUR);
+}
+
+TEST(check_interval_caps_at_max)
+{
+    CHECK(NextCheckInterval(16 * HOUR, HOUR, DAY, false) == DAY);
+    CHECK(NextCheckInterval(DAY, HOUR, DAY, false) == DAY);
+    CHECK(NextCheckInterval(2 * DAY, HOUR, DAY, false) == DAY);
+}
+
+TEST(check_interval_resets_on_change)
+{
+    CHECK(NextCheckInterval(DAY, HOUR, DAY, true) == HOUR);
+    CHECK(NextCheckInterval(HOUR, HOUR, DAY, true) == HOUR);
+}
+
+TEST(check_interval_clamps_to_min)
+{
+    // e.g. the minimum was raised by the application since the last check
+    CHECK(NextCheckInterval(0, HOUR, DAY, false) == 2 * HOUR);
+    CHECK(NextCheckInterval(-1, HOUR, DAY, false) == 2 * HOUR);
+}
+
+TEST(check_interval_without_adaptive_range)
+{
+    CHECK(NextCheckInterval(DAY, HOUR, HOUR, false) == HOUR);
+    CHECK(NextCheckInterval(DAY, DAY, HOUR, false) == DAY);
+}
+
+TEST(check_interval_does_not_overflow)
+{
+    CHECK(NextCheckInterval(INT_MAX / 2 + 1, HOUR, INT_MAX, false) == INT_MAX);
+    CHECK(NextCheckInterval(INT_MAX, HOUR, INT_MAX, false) == INT_MAX);
+}
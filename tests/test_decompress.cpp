@@ -0,0 +1,260 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "testing.h"
+#include "decompress.h"
+
+#include <algorithm>
+#include <string.h>
+
+using namespace winsparkle;
+
+namespace
+{
+
+// Test data were compressed with Python's gzip module.
+
+// "hello, world\n"
+const unsigned char GZ_HELLO[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0xff, 0xcb, 0x48,
+    0xcd, 0xc9, 0xc9, 0xd7, 0x51, 0x28, 0xcf, 0x2f, 0xca, 0x49, 0xe1, 0x02,
+    0x00, 0x53, 0x74, 0x24, 0xf4, 0x0d, 0x00, 0x00, 0x00
+};
+
+// "stored data", not compressed, with FNAME header field
+const unsigned char GZ_NAMED_STORED[] = {
+    0x1f, 0x8b, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x66, 0x69,
+    0x6c, 0x65, 0x2e, 0x74, 0x78, 0x74, 0x00, 0x01, 0x0b, 0x00, 0xf4, 0xff,
+    0x73, 0x74, 0x6f, 0x72, 0x65, 0x64, 0x20, 0x64, 0x61, 0x74, 0x61, 0x11,
+    0x55, 0xd7, 0x99, 0x0b, 0x00, 0x00, 0x00
+};
+
+// LcgText(400), compressed with dynamic Huffman codes
+const unsigned char GZ_DYNAMIC[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0xff, 0x15, 0x8f,
+    0xc7, 0x01, 0xc0, 0x30, 0x08, 0x03, 0x67, 0xc5, 0x98, 0x5e, 0xf7, 0x7f,
+    0xc5, 0x79, 0x8b, 0x43, 0xba, 0x22, 0x8e, 0xed, 0x8e, 0xe0, 0xca, 0xd9,
+    0x0b, 0x5e, 0x0d, 0xeb, 0x0b, 0x4d, 0x45, 0x8d, 0x29, 0x76, 0x03, 0x77,
+    0x47, 0xcd, 0xcf, 0x38, 0xa4, 0x31, 0x97, 0xfb, 0x59, 0x11, 0x9c, 0x2d,
+    0xe7, 0x4e, 0xb2, 0xf0, 0xa2, 0x8b, 0x23, 0x7b, 0xa3, 0x1f, 0xf4, 0xee,
+    0x16, 0x44, 0xab, 0x48, 0x51, 0xba, 0xc0, 0x83, 0x5c, 0x04, 0xf2, 0x0a,
+    0x21, 0x3e, 0xe0, 0x2a, 0x47, 0x84, 0xc5, 0x3c, 0x54, 0xe6, 0xce, 0x0d,
+    0x83, 0xb6, 0xb4, 0x8d, 0x97, 0x97, 0x69, 0x96, 0x06, 0x19, 0x72, 0x66,
+    0x43, 0xa9, 0xc9, 0x62, 0xdb, 0x39, 0x3e, 0x97, 0x13, 0x59, 0x27, 0x0e,
+    0x89, 0xe9, 0xab, 0xcc, 0x71, 0x3e, 0x48, 0x87, 0xa2, 0xc2, 0x8d, 0x58,
+    0x1b, 0x0d, 0x97, 0xb3, 0x3c, 0x2a, 0x79, 0xd6, 0x02, 0xaa, 0x64, 0x34,
+    0x23, 0x7b, 0xf4, 0x5e, 0xac, 0x5d, 0x2c, 0xbd, 0x8c, 0xd9, 0xca, 0xb0,
+    0xe6, 0xb1, 0x1a, 0xbf, 0x05, 0x85, 0xf1, 0xdc, 0xb6, 0xea, 0xd6, 0xf4,
+    0x37, 0xfb, 0xd2, 0x46, 0xd1, 0x01, 0x31, 0xab, 0xb3, 0x67, 0x6c, 0x7c,
+    0x02, 0x12, 0x22, 0xc4, 0x05, 0x96, 0xf5, 0xa5, 0x7d, 0xd3, 0x4d, 0x05,
+    0x24, 0xed, 0x80, 0xb7, 0x23, 0x26, 0x0d, 0x62, 0xbc, 0x49, 0x03, 0x40,
+    0x1a, 0x0b, 0xd5, 0x33, 0xc8, 0x6e, 0x62, 0x47, 0xfd, 0xd6, 0x79, 0x1d,
+    0xf8, 0x3b, 0x92, 0xee, 0xfb, 0x3f, 0xf2, 0xdc, 0x25, 0x15, 0xf4, 0xa9,
+    0x1c, 0x26, 0x61, 0x1b, 0x84, 0x0f, 0xd0, 0xab, 0x80, 0x15, 0x90, 0x01,
+    0x00, 0x00
+};
+
+// Pseudo-random text with a limited alphabet, which compresses well enough
+// to use dynamic Huffman codes.
+std::string LcgText(size_t len)
+{
+    std::string text;
+    uint32_t x = 12345;
+    for ( size_t i = 0; i < len; i++ )
+    {
+        x = (x * 1103515245 + 12345) & 0x7FFFFFFF;
+        text += char('a' + (x >> 16) % 16);
+    }
+    return text;
+}
+
+struct StringSink : public IDownloadSink
+{
+    virtual void SetLength(size_t) {}
+    virtual void SetFilename(const std::wstring&) {}
+    virtual void Add(const void *p, size_t len) { data.append(static_cast<const char*>(p), len); }
+
+    std::string data;
+};
+
+struct CountingSink : public IDownloadSink
+{
+    CountingSink() : size(0) {}
+
+    virtual void SetLength(size_t) {}
+    virtual void SetFilename(const std::wstring&) {}
+    virtual void Add(const void *, size_t len) { size += len; }
+
+    uint64_t size;
+};
+
+template<size_t N>
+std::string Data(const unsigned char (&bytes)[N])
+{
+    return std::string(reinterpret_cast<const char*>(bytes), N);
+}
+
+// Decompresses input, passing it to the decoder in pieces of given size.
+std::string Decompress(const std::string& input, size_t piece = 0, uint64_t expectedSize = 0)
+{
+    GzipDecoder decoder;
+    decoder.SetExpectedSize(expectedSize);
+    StringSink sink;
+    if ( !piece )
+        piece = input.size();
+    for ( size_t pos = 0; pos < input.size(); pos += piece )
+        decoder.Decode(input.data() + pos, (std::min)(piece, input.size() - pos), sink);
+    decoder.Finish(sink);
+    return sink.data;
+}
+
+// Writes deflate bit stream.
+struct BitWriter
+{
+    BitWriter() : bits(0), count(0) {}
+
+    void Put(unsigned value, unsigned n)
+    {
+        bits |= value << count;
+        count += n;
+        while ( count >= 8 )
+        {
+            data += char(bits & 0xFF);
+            bits >>= 8;
+            count -= 8;
+        }
+    }
+
+    // Huffman codes are stored starting with the most significant bit
+    void PutCode(unsigned code, unsigned n)
+    {
+        for ( unsigned i = n; i > 0; i-- )
+            Put((code >> (i - 1)) & 1, 1);
+    }
+
+    std::string data;
+    unsigned bits, count;
+};
+
+// Creates gzip member with one zero byte repeated by @a copies of maximum
+// length (258 bytes) back-references, without the trailer. That's about
+// 160 bytes of output per byte of input.
+std::string MakeBomb(unsigned copies)
+{
+    BitWriter w;
+    w.data = std::string("\x1F\x8B\x08\x00\x00\x00\x00\x00\x00\xFF", 10);
+    w.Put(1, 1);              // last block
+    w.Put(1, 2);              // fixed Huffman codes
+    w.PutCode(0x30, 8);       // literal 0
+    for ( unsigned i = 0; i < copies; i++ )
+    {
+        w.PutCode(0xC5, 8);   // length 258
+        w.PutCode(0, 5);      // distance 1
+    }
+    return w.data;
+}
+
+} // anonymous namespace
+
+
+TEST(gzip_decode)
+{
+    CHECK(Decompress(Data(GZ_HELLO)) == "hello, world\n");
+    CHECK(Decompress(Data(GZ_NAMED_STORED)) == "stored data");
+    CHECK(Decompress(Data(GZ_DYNAMIC)) == LcgText(400));
+}
+
+TEST(gzip_decode_in_pieces)
+{
+    for ( size_t piece = 1; piece < 20; piece++ )
+    {
+        CHECK(Decompress(Data(GZ_HELLO), piece) == "hello, world\n");
+        CHECK(Decompress(Data(GZ_DYNAMIC), piece) == LcgText(400));
+    }
+}
+
+TEST(gzip_multiple_members)
+{
+    CHECK(Decompress(Data(GZ_HELLO) + Data(GZ_NAMED_STORED)) == "hello, world\nstored data");
+    CHECK(Decompress(Data(GZ_HELLO) + Data(GZ_HELLO), 3) == "hello, world\nhello, world\n");
+}
+
+TEST(gzip_zero_padding)
+{
+    const std::string padding(100, '\0');
+    CHECK(Decompress(Data(GZ_HELLO) + padding) == "hello, world\n");
+    CHECK(Decompress(Data(GZ_HELLO) + padding, 7) == "hello, world\n");
+    CHECK(Decompress(Data(GZ_HELLO) + Data(GZ_HELLO) + std::string(1, '\0')) == "hello, world\nhello, world\n");
+
+    // only zeros are allowed after the last member, and only after it
+    CHECK_THROWS(Decompress(Data(GZ_HELLO) + padding + "x"));
+    CHECK_THROWS(Decompress(padding + Data(GZ_HELLO)));
+}
+
+TEST(gzip_invalid_data)
+{
+    const std::string hello = Data(GZ_HELLO);
+
+    CHECK_THROWS(Decompress(std::string()));
+    CHECK_THROWS(Decompress("not gzip data"));
+
+    // truncated
+    for ( size_t len = 1; len < hello.size(); len++ )
+        CHECK_THROWS(Decompress(hello.substr(0, len)));
+
+    // corrupted CRC and size in the trailer
+    for ( size_t i = hello.size() - 8; i < hello.size(); i++ )
+    {
+        std::string corrupted(hello);
+        corrupted[i] ^= 1;
+        CHECK_THROWS(Decompress(corrupted));
+    }
+}
+
+TEST(gzip_expected_size)
+{
+    CHECK(Decompress(Data(GZ_HELLO), 0, 13) == "hello, world\n");
+    CHECK_THROWS(Decompress(Data(GZ_HELLO), 0, 12));
+    CHECK_THROWS(Decompress(Data(GZ_HELLO), 0, 14));
+}
+
+TEST(gzip_ratio_limit)
+{
+    // about 64 MB of output from 400 kB of input
+    const unsigned copies = 250000;
+    const std::string bomb = MakeBomb(copies);
+
+    GzipDecoder decoder;
+    CountingSink sink;
+    CHECK_THROWS(decoder.Decode(bomb.data(), bomb.size(), sink));
+    CHECK(sink.size <= uint64_t(bomb.size()) * GzipDecoder::MAX_RATIO + 16 * 1024 * 1024);
+
+    // known size allows any ratio
+    GzipDecoder decoder2;
+    decoder2.SetExpectedSize(uint64_t(copies) * 258 + 1);
+    CountingSink sink2;
+    decoder2.Decode(bomb.data(), bomb.size(), sink2);
+    CHECK(sink2.size > uint64_t(bomb.size()) * GzipDecoder::MAX_RATIO);
+}
@@ -0,0 +1,153 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "testing.h"
+#include "eventstream.h"
+
+#include <string>
+#include <vector>
+
+using namespace winsparkle;
+
+namespace
+{
+
+struct RecordingHandler : public IEventStreamHandler
+{
+    RecordingHandler() : connected(false), notifications(0) {}
+
+    virtual void OnConnected() { connected = true; }
+    virtual void OnNotification() { notifications++; }
+    virtual void OnRetryDelay(unsigned delayMilliseconds) { retries.push_back(delayMilliseconds); }
+
+    bool connected;
+    int notifications;
+    std::vector<unsigned> retries;
+};
+
+// Feeds the data to the parser one byte at a time, to exercise chunk boundaries
+void AddBytewise(EventStreamParser& parser, const std::string& data)
+{
+    for ( char c : data )
+        parser.Add(&c, 1);
+}
+
+void Add(EventStreamParser& parser, const std::string& data)
+{
+    parser.Add(data.data(), data.size());
+}
+
+} // anonymous namespace
+
+
+TEST(eventstream_connected)
+{
+    RecordingHandler handler;
+    EventStreamParser parser(handler);
+    CHECK(!handler.connected);
+    parser.SetFilename(L"");
+    CHECK(handler.connected);
+}
+
+TEST(eventstream_line_endings)
+{
+    const char *streams[] =
+    {
+        "data: 1\n\ndata: 2\n\n",
+        "data: 1\r\rdata: 2\r\r",
+        "data: 1\r\n\r\ndata: 2\r\n\r\n",
+        "data: 1\r\n\ndata: 2\r\r\n"
+    };
+
+    for ( const char *s : streams )
+    {
+        RecordingHandler whole;
+        EventStreamParser wholeParser(whole);
+        Add(wholeParser, s);
+        CHECK(whole.notifications == 2);
+
+        RecordingHandler split;
+        EventStreamParser splitParser(split);
+        AddBytewise(splitParser, s);
+        CHECK(split.notifications == 2);
+    }
+}
+
+TEST(eventstream_crlf_split_across_chunks)
+{
+    // CR at the end of one chunk and LF at the start of the next one is
+    // a single line break, not an empty line
+    RecordingHandler handler;
+    EventStreamParser parser(handler);
+    Add(parser, "data: 1\r");
+    Add(parser, "\nid: 2\r");
+    CHECK(handler.notifications == 0);
+    Add(parser, "\n\r");
+    CHECK(handler.notifications == 1);
+}
+
+TEST(eventstream_dispatch_requires_data)
+{
+    RecordingHandler handler;
+    EventStreamParser parser(handler);
+    Add(parser, "\n\nevent: release\nid: 1\n\n");
+    CHECK(handler.notifications == 0);
+    Add(parser, "event: release\ndata\n\n");
+    CHECK(handler.notifications == 1);
+    // incomplete event isn't dispatched
+    Add(parser, "data: 1\n");
+    CHECK(handler.notifications == 1);
+}
+
+TEST(eventstream_comments)
+{
+    RecordingHandler handler;
+    EventStreamParser parser(handler);
+    AddBytewise(parser, ": keep-alive\n\n:\n\n: data: 1\n\n");
+    CHECK(handler.notifications == 0);
+    CHECK(handler.retries.empty());
+}
+
+TEST(eventstream_retry)
+{
+    RecordingHandler handler;
+    EventStreamParser parser(handler);
+    AddBytewise(parser, "retry: 60000\nretry:5000\nretry: 1x\nretry: -1\nretry:\n\n");
+    CHECK(handler.retries.size() == 2);
+    CHECK(handler.retries[0] == 60000);
+    CHECK(handler.retries[1] == 5000);
+    CHECK(handler.notifications == 0);
+}
+
+TEST(eventstream_long_line)
+{
+    RecordingHandler handler;
+    EventStreamParser parser(handler);
+    Add(parser, "data: " + std::string(EventStreamParser::MAX_LINE_LENGTH - 6, 'x') + "\n\n");
+    CHECK(handler.notifications == 1);
+
+    const std::string tooLong(size_t(EventStreamParser::MAX_LINE_LENGTH) + 1, 'x');
+    CHECK_THROWS(Add(parser, tooLong));
+}
@@ -0,0 +1,199 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "testing.h"
+#include "feedstate.h"
+
+#include <string>
+#include <vector>
+
+using namespace winsparkle;
+
+namespace
+{
+
+const std::string HEAD = "<?xml version=\"1.0\"?>\n<rss><channel><sparkle:appendOnly/>\n";
+const std::string END = "</channel></rss>\n";
+
+std::string Item(int version, const std::string& notes = "")
+{
+    return "<item><sparkle:version>" + std::to_string(version) + "</sparkle:version>"
+           "<description>" + (notes.empty() ? std::string(300, 'x') : notes) + "</description></item>";
+}
+
+// Finds the items in the XML like Appcast::Load() would
+std::vector<Appcast> FindItems(const std::string& doc, AppcastChannel& channel)
+{
+    std::vector<Appcast> items;
+    channel = AppcastChannel();
+    for ( size_t pos = doc.find("<item>"); pos != std::string::npos; pos = doc.find("<item>", pos) )
+    {
+        Appcast item;
+        item.SourceBegin = pos;
+        item.SourceEnd = pos = doc.find("</item>", pos) + 7;
+        items.push_back(item);
+
+        if ( !channel.ItemsBegin )
+            channel.ItemsBegin = item.SourceBegin;
+        channel.ItemsEnd = item.SourceEnd;
+    }
+    return items;
+}
+
+} // anonymous namespace
+
+
+TEST(feedstate_serialize)
+{
+    FeedState state;
+    state.url = "https://example.com/appcast.xml";
+    state.systemKey = "10.0.19045.0 x64";
+    state.offset = 12345;
+    state.hash = "abcdef";
+    state.prefix = HEAD + Item(1);
+    state.headLength = HEAD.size();
+
+    FeedState loaded;
+    CHECK(loaded.Deserialize(state.Serialize()));
+    CHECK(loaded.url == state.url);
+    CHECK(loaded.systemKey == state.systemKey);
+    CHECK(loaded.offset == state.offset);
+    CHECK(loaded.hash == state.hash);
+    CHECK(loaded.prefix == state.prefix);
+    CHECK(loaded.headLength == state.headLength);
+}
+
+TEST(feedstate_deserialize_invalid)
+{
+    FeedState state;
+    CHECK(!state.Deserialize(""));
+    CHECK(!state.Deserialize("url\nsystem\n"));
+    CHECK(!state.Deserialize("url\nsystem\nxyz 0 hash\n<rss>"));
+    // no items processed
+    CHECK(!state.Deserialize("url\nsystem\n0 0 hash\n<rss>"));
+    // head longer than the prefix
+    CHECK(!state.Deserialize("url\nsystem\n100 6 hash\n<rss>"));
+    CHECK(state.Deserialize("url\nsystem\n100 5 hash\n<rss>"));
+}
+
+TEST(feedstate_no_items)
+{
+    const std::string feed = HEAD + END;
+    AppcastChannel channel;
+    std::vector<Appcast> items = FindItems(feed, channel);
+
+    FeedState state;
+    CHECK(!state.Update(feed, channel, std::vector<const Appcast*>(), feed, 0, 0));
+    CHECK(state.offset == 0);
+}
+
+TEST(feedstate_short_feed)
+{
+    // the check region can't extend before the start of the feed
+    const std::string feed = "<rss><item/></rss>";
+    AppcastChannel channel;
+    channel.ItemsBegin = 5;
+    channel.ItemsEnd = 12;
+
+    FeedState state;
+    CHECK(state.Update(feed, channel, std::vector<const Appcast*>(), feed, 0, 0));
+    CHECK(state.offset == 12);
+    CHECK(state.GetCheckRegionSize() == 12);
+    CHECK(state.GetResumeOffset() == 0);
+    CHECK(state.prefix == "<rss>");
+    CHECK(state.IsContinuedBy(feed));
+    CHECK(!state.IsContinuedBy(feed.substr(0, 11)));
+}
+
+TEST(feedstate_incremental)
+{
+    // full download
+    const std::string feed = HEAD + Item(1) + Item(2) + END;
+    AppcastChannel channel;
+    std::vector<Appcast> items = FindItems(feed, channel);
+    CHECK(items.size() == 2);
+
+    FeedState state;
+    CHECK(state.Update(feed, channel, { &items[1] }, feed, 0, 0));
+    CHECK(state.offset == feed.size() - END.size());
+    CHECK(state.headLength == HEAD.size());
+    CHECK(state.prefix == HEAD + Item(2));
+    CHECK(state.GetCheckRegionSize() == FeedState::CHECK_REGION_SIZE);
+    CHECK(state.hash == HashRegion(feed, state.offset - FeedState::CHECK_REGION_SIZE,
+                                   FeedState::CHECK_REGION_SIZE));
+
+    // unchanged feed continues the same, even with no new data
+    CHECK(state.IsContinuedBy(feed.substr(state.GetResumeOffset())));
+
+    // an item was appended
+    const std::string appended = HEAD + Item(1) + Item(2) + Item(3) + END;
+    const size_t base = state.GetResumeOffset();
+    const size_t skip = state.GetCheckRegionSize();
+    const std::string tail = appended.substr(base);
+    CHECK(state.IsContinuedBy(tail));
+
+    const std::string doc = state.prefix + tail.substr(skip);
+    CHECK(doc == HEAD + Item(2) + Item(3) + END);
+    items = FindItems(doc, channel);
+    CHECK(items.size() == 2);
+
+    CHECK(state.Update(doc, channel, { &items[1] }, tail, base, skip));
+    CHECK(state.offset == appended.size() - END.size());
+    CHECK(state.headLength == HEAD.size());
+    CHECK(state.prefix == HEAD + Item(3));
+    CHECK(state.hash == HashRegion(appended, state.offset - FeedState::CHECK_REGION_SIZE,
+                                   FeedState::CHECK_REGION_SIZE));
+    CHECK(state.IsContinuedBy(appended.substr(state.GetResumeOffset())));
+}
+
+TEST(feedstate_modified_feed)
+{
+    const std::string feed = HEAD + Item(1) + Item(2) + END;
+    AppcastChannel channel;
+    std::vector<Appcast> items = FindItems(feed, channel);
+
+    FeedState state;
+    CHECK(state.Update(feed, channel, { &items[1] }, feed, 0, 0));
+
+    // the last processed item was edited
+    const std::string edited = HEAD + Item(1) + Item(2, std::string(300, 'y')) + Item(3) + END;
+    CHECK(!state.IsContinuedBy(edited.substr(state.GetResumeOffset())));
+
+    // the feed was truncated
+    CHECK(!state.IsContinuedBy(feed.substr(state.GetResumeOffset(), 100)));
+    CHECK(!state.IsContinuedBy(""));
+}
+
+TEST(feedstate_retained_in_feed_order)
+{
+    const std::string feed = HEAD + Item(1) + Item(2) + Item(3) + END;
+    AppcastChannel channel;
+    std::vector<Appcast> items = FindItems(feed, channel);
+
+    // e.g. the newest item and an older critical one
+    FeedState state;
+    CHECK(state.Update(feed, channel, { &items[2], &items[0] }, feed, 0, 0));
+    CHECK(state.prefix == HEAD + Item(1) + Item(3));
+}
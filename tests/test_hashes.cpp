@@ -0,0 +1,113 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "testing.h"
+#include "hashes.h"
+
+#include <algorithm>
+
+using namespace winsparkle;
+
+namespace
+{
+
+std::string TestData(size_t len)
+{
+    std::string data(len, '\0');
+    for ( size_t i = 0; i < len; i++ )
+        data[i] = char(i % 251);
+    return data;
+}
+
+// Computes the tree hash of data the same way as the verifier does.
+std::string TreeHash(const std::string& data)
+{
+    std::string leaves;
+    size_t pos = 0;
+    do
+    {
+        const size_t len = (std::min)(size_t(TreeHasher::LEAF_SIZE), data.size() - pos);
+        unsigned char leaf[TreeHasher::HASH_SIZE];
+        TreeHasher::HashLeaf(data.data() + pos, len, leaf);
+        leaves.append(reinterpret_cast<const char*>(leaf), sizeof(leaf));
+        pos += len;
+    } while ( pos < data.size() );
+
+    unsigned char root[TreeHasher::HASH_SIZE];
+    TreeHasher::Root(leaves, root);
+    return HashToHex(root, sizeof(root));
+}
+
+} // anonymous namespace
+
+
+TEST(sha512)
+{
+    unsigned char hash[SHA512Hasher::HASH_SIZE];
+    SHA512Hasher::Hash("abc", 3, hash);
+    CHECK(HashToHex(hash, sizeof(hash)) ==
+          "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+          "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f");
+}
+
+TEST(tree_hash)
+{
+    // expected values were computed with Python's hashlib
+    const size_t M = TreeHasher::LEAF_SIZE;
+    struct
+    {
+        size_t len;
+        const char *root;
+    } vectors[] =
+    {
+        // empty data have one empty leaf
+        { 0,
+          "b8244d028981d693af7b456af8efa4cad63d282e19ff14942c246e50d9351d22"
+          "704a802a71c3580b6370de4ceb293c324a8423342557d4e5c38438f0e36910ee" },
+        { 100,
+          "8772e69994dc77ef5eba66d78cc72b336f4e4a6e5de73c517a5dc2471967bb31"
+          "efb1b14932fdc6d2d6be28740b8d7ce08a2dda419157b3b331b683ce61a5868a" },
+        { M,
+          "29096e3b8871fc0c40e90c8c5d54c6926c4dc3fe8023237fee3c8f2ff2fffce9"
+          "f9f4dc092e06312233f954fc4d3cc29bf7a0beff1219cbb9eb0c25142961c05d" },
+        // odd number of nodes at some levels
+        { M * 5 / 2,
+          "03a7fa9b10c01298fa115a90ac88d682f3770efc9f3872bafbbdb47c833d4cce"
+          "440305cb5eb66c41c1e0ddbe8829aabe87de80188ba1e14c789e3ff5ae6a9139" },
+        { M * 5 + 7,
+          "e0c9e922264e5fdedf0f98391d8ccc2df2296a1e072d46766c131fb3214d164f"
+          "b3912263e880ac265211785243e947ae019a8c5588f26414a6a7b2c3bd1bbafb" }
+    };
+
+    for ( const auto& v : vectors )
+        CHECK(TreeHash(TestData(v.len)) == v.root);
+}
+
+TEST(tree_hash_invalid_leaves)
+{
+    unsigned char root[TreeHasher::HASH_SIZE];
+    CHECK_THROWS(TreeHasher::Root(std::string(), root));
+    CHECK_THROWS(TreeHasher::Root(std::string(TreeHasher::HASH_SIZE + 1, 'x'), root));
+}
@@ -0,0 +1,74 @@
+/*
+ *  This file is part of WinSparkle (https://winsparkle.org)
+ *
+ *  Copyright (C) 2009-2026 Vaclav Slavik
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in
+ *  all copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef _testing_h_
+#define _testing_h_
+
+#include <stdexcept>
+#include <string>
+
+/**
+    Minimal unit testing support.
+
+    Tests are functions defined with TEST(), which use CHECK() and
+    CHECK_THROWS() to verify their expectations. The first failed check
+    ends the test.
+ */
+namespace testing
+{
+
+typedef void (*TestFunction)();
+
+/// Registers a test; used by TEST().
+struct TestRegistration
+{
+    TestRegistration(const char *name, TestFunction func);
+};
+
+/// Reports a failed check by throwing; used by CHECK() and CHECK_THROWS().
+void Fail(const char *file, int line, const std::string& what);
+
+} // namespace testing
+
+#define TEST(name)                                                          \
+    static void test_##name();                                              \
+    static testing::TestRegistration register_##name(#name, &test_##name); \
+    static void test_##name()
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if ( !(cond) )                                                      \
+            testing::Fail(__FILE__, __LINE__, #cond);                       \
+    } while (0)
+
+#define CHECK_THROWS(expr)                                                  \
+    do {                                                                    \
+        bool thrown_ = false;                                               \
+        try { expr; } catch ( std::exception& ) { thrown_ = true; }         \
+        if ( !thrown_ )                                                     \
+            testing::Fail(__FILE__, __LINE__, #expr " didn't throw");       \
+    } while (0)
+
+#endif // _testing_h_
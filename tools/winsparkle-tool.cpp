@@ -24,63 +24,187 @@
  */
 
 #include "winsparkle-version.h"
+#include "base64.h"
 
 #include <argparse/argparse.hpp>
 #include <ed25519.h>
 
+extern "C"
+{
+#include <sha512.h>
+#include <ge.h>
+#include <sc.h>
+}
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <iterator>
 #include <fstream>
+#include <map>
+#include <regex>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
+
+using winsparkle::Base64Encode;
+using winsparkle::Base64Decode;
 
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
-#include <wincrypt.h>
-#ifdef _MSC_VER
-#pragma comment(lib, "crypt32.lib")
-#endif
+// Base64Decode() returns the data in std::string
+inline const uint8_t* as_bytes(const std::string& data)
+{
+    return reinterpret_cast<const uint8_t*>(data.data());
+}
 
 
 bool g_verbose = false;
+bool g_tree = false;
+bool g_chunk_manifest = false;
+
+
+// Tree hashes, signed by sparkle:edSignatureTree, must be computed the same
+// way as by WinSparkle's TreeHasher: the file is split into leaves of
+// TREE_LEAF_SIZE bytes (empty file has one empty leaf), leaves are hashed
+// as SHA-512(0x00 || leaf), inner nodes as SHA-512(0x01 || left || right)
+// and nodes without a sibling move up unchanged.
+const size_t TREE_LEAF_SIZE = 1024 * 1024;
+const size_t TREE_HASH_SIZE = 64;
 
+// The signed message is the root hash prefixed with this context, including
+// the terminating NUL, so that a tree signature can't be used as signature
+// of a file (see EDDSA_TREE_CONTEXT in WinSparkle).
+const char TREE_SIGNATURE_CONTEXT[] = "WinSparkle tree v1";
 
-std::string base64_encode(const uint8_t* data, size_t len)
+void tree_hash_leaves(const std::string& filename, size_t first, size_t count, uint8_t* hashes)
 {
-    DWORD base64_len = 0;
-    if (!CryptBinaryToStringA(data, (DWORD)len, CRYPT_STRING_BASE64 | CRYPT_STRING_NOCRLF, NULL, &base64_len))
+    std::ifstream file(filename, std::ios::binary);
+    if (!file || !file.seekg(std::streamoff(first) * TREE_LEAF_SIZE))
     {
-        throw std::runtime_error("Failed to encode as base64");
+        throw std::runtime_error("Failed to read file");
     }
 
-    // base64_len includes the null terminator, the actual string length is one less
-    std::string str(base64_len - 1, '\0');
-    if (!CryptBinaryToStringA(data, (DWORD)len, CRYPT_STRING_BASE64 | CRYPT_STRING_NOCRLF, str.data(), &base64_len))
+    const unsigned char leaf_prefix = 0x00;
+    std::vector<char> buffer(TREE_LEAF_SIZE);
+    for (size_t i = 0; i < count; i++)
     {
-        throw std::runtime_error("Failed to encode as base64");
-    }
+        file.read(buffer.data(), buffer.size());
+        if (file.bad())
+        {
+            throw std::runtime_error("Failed to read file");
+        }
 
-    return str;
+        sha512_context ctx;
+        sha512_init(&ctx);
+        sha512_update(&ctx, &leaf_prefix, 1);
+        sha512_update(&ctx, reinterpret_cast<const unsigned char*>(buffer.data()), size_t(file.gcount()));
+        sha512_final(&ctx, hashes + i * TREE_HASH_SIZE);
+    }
 }
 
-std::vector<uint8_t> base64_decode(const std::string& base64)
+void tree_hash_file(const std::string& filename, uint8_t root[TREE_HASH_SIZE])
 {
-    DWORD size = 0;
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        throw std::runtime_error("Failed to open file for reading");
+    }
+    // the file may be larger than 4 GB even in 32-bit builds
+    const uint64_t size = static_cast<uint64_t>(file.tellg());
+    file.close();
+
+    const size_t leaves = static_cast<size_t>(std::max<uint64_t>((size + TREE_LEAF_SIZE - 1) / TREE_LEAF_SIZE, 1));
+    const size_t parts = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), leaves);
+
+    std::vector<uint8_t> level(leaves * TREE_HASH_SIZE);
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(parts);
+    for (size_t i = 0; i < parts; i++)
+    {
+        const size_t first = i * leaves / parts;
+        const size_t last = (i + 1) * leaves / parts;
+        threads.emplace_back([&, i, first, last]
+        {
+            try
+            {
+                tree_hash_leaves(filename, first, last - first, level.data() + first * TREE_HASH_SIZE);
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+    for (auto& e : errors)
+    {
+        if (e)
+            std::rethrow_exception(e);
+    }
 
-    if (!CryptStringToBinaryA(&base64[0], (DWORD)base64.size(), CRYPT_STRING_BASE64, NULL, &size, NULL, NULL))
+    const unsigned char node_prefix = 0x01;
+    while (level.size() > TREE_HASH_SIZE)
     {
-        throw std::runtime_error("Failed to decode base64 string");
+        std::vector<uint8_t> next;
+        for (size_t i = 0; i < level.size(); i += 2 * TREE_HASH_SIZE)
+        {
+            if (i + TREE_HASH_SIZE == level.size())
+            {
+                next.insert(next.end(), level.begin() + i, level.end());
+                break;
+            }
+
+            uint8_t node[TREE_HASH_SIZE];
+            sha512_context ctx;
+            sha512_init(&ctx);
+            sha512_update(&ctx, &node_prefix, 1);
+            sha512_update(&ctx, level.data() + i, 2 * TREE_HASH_SIZE);
+            sha512_final(&ctx, node);
+            next.insert(next.end(), node, node + TREE_HASH_SIZE);
+        }
+        level.swap(next);
     }
 
-    if (size == 0)
-        return {};
+    std::copy(level.begin(), level.end(), root);
+}
+
+// Chunk manifests are signed with this prefix, for the same reason as tree
+// hashes (see EDDSA_CHUNK_MANIFEST_CONTEXT in WinSparkle).
+const char CHUNK_MANIFEST_SIGNATURE_CONTEXT[] = "WinSparkle chunk manifest v1";
+
+// Returns the message signed by the signature of the chunk manifest.
+std::vector<uint8_t> chunk_manifest_signed_message(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Failed to open file for reading");
+    }
 
-    std::vector<uint8_t> bin(size);
-    if (!CryptStringToBinaryA(&base64[0], (DWORD)base64.size(), CRYPT_STRING_BASE64, (BYTE*)&bin[0], &size, NULL, NULL))
+    std::vector<uint8_t> message(CHUNK_MANIFEST_SIGNATURE_CONTEXT,
+                                 CHUNK_MANIFEST_SIGNATURE_CONTEXT + sizeof(CHUNK_MANIFEST_SIGNATURE_CONTEXT));
+    message.insert(message.end(), std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (file.bad())
     {
-        throw std::runtime_error("Failed to decode base64 string");
+        throw std::runtime_error("Failed to read file");
     }
+    return message;
+}
+
+// Returns the message signed by the tree signature of the file.
+std::vector<uint8_t> tree_signed_message(const std::string& filename)
+{
+    uint8_t root[TREE_HASH_SIZE];
+    tree_hash_file(filename, root);
 
-    return bin;
+    std::vector<uint8_t> message(TREE_SIGNATURE_CONTEXT, TREE_SIGNATURE_CONTEXT + sizeof(TREE_SIGNATURE_CONTEXT));
+    message.insert(message.end(), root, root + sizeof(root));
+    return message;
 }
 
 
@@ -91,6 +215,122 @@ struct KeyData
 };
 
 
+// Files are signed and verified without loading them into memory, which
+// doesn't work well with installers that are several gigabytes large. They
+// are read in blocks of this size instead.
+const size_t FILE_BLOCK_SIZE = 1024 * 1024;
+
+// Passes the file's content to ctx and, if not null, to digest.
+// Returns the size of the file.
+uint64_t hash_file(const std::filesystem::path& filename, sha512_context* ctx, sha512_context* digest = nullptr)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Failed to open file for reading");
+    }
+
+    uint64_t size = 0;
+    std::vector<char> buffer(FILE_BLOCK_SIZE);
+    while (file)
+    {
+        file.read(buffer.data(), buffer.size());
+        if (file.bad())
+        {
+            throw std::runtime_error("Failed to read file");
+        }
+
+        auto data = reinterpret_cast<const unsigned char*>(buffer.data());
+        const size_t len = size_t(file.gcount());
+        sha512_update(ctx, data, len);
+        if (digest)
+            sha512_update(digest, data, len);
+        size += len;
+    }
+
+    return size;
+}
+
+
+// This is ed25519_sign() reading the message from a file. The message is
+// used twice, to derive the nonce r and in the hash of R || A || M, so the
+// file is read twice too. If digest is not null, it is set to the file's
+// SHA-512 hash.
+uint64_t ed25519_sign_file(uint8_t signature[64], const KeyData& key, const std::filesystem::path& filename,
+                           uint8_t* digest = nullptr)
+{
+    sha512_context hash;
+    sha512_context digest1, digest2;
+    unsigned char r[64];
+    unsigned char hram[64];
+    ge_p3 R;
+
+    sha512_init(&hash);
+    sha512_init(&digest1);
+    sha512_update(&hash, key.private_key + 32, 32);
+    const uint64_t size = hash_file(filename, &hash, &digest1);
+    sha512_final(&hash, r);
+
+    sc_reduce(r);
+    ge_scalarmult_base(&R, r);
+    ge_p3_tobytes(signature, &R);
+
+    sha512_init(&hash);
+    sha512_init(&digest2);
+    sha512_update(&hash, signature, 32);
+    sha512_update(&hash, key.public_key, 32);
+    hash_file(filename, &hash, &digest2);
+    sha512_final(&hash, hram);
+
+    // Signing a different message with the same r would reveal the private
+    // key, so make sure the file didn't change between the two passes.
+    unsigned char d1[64], d2[64];
+    sha512_final(&digest1, d1);
+    sha512_final(&digest2, d2);
+    if (memcmp(d1, d2, sizeof(d1)) != 0)
+    {
+        throw std::runtime_error("File changed while it was being signed");
+    }
+
+    sc_reduce(hram);
+    sc_muladd(signature + 32, hram, key.private_key, r);
+
+    if (digest)
+        memcpy(digest, d1, sizeof(d1));
+
+    return size;
+}
+
+
+// This is ed25519_verify() reading the message from a file.
+bool ed25519_verify_file(const uint8_t* signature, const uint8_t* public_key, const std::filesystem::path& filename)
+{
+    sha512_context hash;
+    unsigned char h[64];
+    unsigned char checker[32];
+    ge_p3 A;
+    ge_p2 R;
+
+    if (signature[63] & 224)
+        return false;
+
+    if (ge_frombytes_negate_vartime(&A, public_key) != 0)
+        return false;
+
+    sha512_init(&hash);
+    sha512_update(&hash, signature, 32);
+    sha512_update(&hash, public_key, 32);
+    hash_file(filename, &hash);
+    sha512_final(&hash, h);
+
+    sc_reduce(h);
+    ge_double_scalarmult_vartime(&R, h, &A, signature + 32);
+    ge_tobytes(checker, &R);
+
+    return memcmp(checker, signature, 32) == 0;
+}
+
+
 KeyData load_private_key(const std::string& private_key_file)
 {
     std::ifstream file(private_key_file);
@@ -102,11 +342,11 @@ KeyData load_private_key(const std::string& private_key_file)
     file >> seed_str;
     file.close();
 
-    auto seed = base64_decode(seed_str);
+    auto seed = Base64Decode(seed_str);
     if (seed.size() == 32)
     {
         KeyData key;
-        ed25519_create_keypair(key.public_key, key.private_key, seed.data());
+        ed25519_create_keypair(key.public_key, key.private_key, as_bytes(seed));
         return key;
     }
     else if (seed.size() == 64 + 32)
@@ -126,12 +366,35 @@ KeyData load_private_key(const std::string& private_key_file)
 }
 
 
+std::string to_hex(const uint8_t* data, size_t len)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (size_t i = 0; i < len; i++)
+    {
+        hex += digits[data[i] >> 4];
+        hex += digits[data[i] & 0x0F];
+    }
+    return hex;
+}
+
+// ID of the key for sparkle:edKeyId, the same as computed by WinSparkle:
+// the first 8 bytes of the public key's SHA-512 hash, hex-encoded.
+std::string key_id(const KeyData& key)
+{
+    uint8_t hash[64];
+    sha512(key.public_key, sizeof(key.public_key), hash);
+    return to_hex(hash, 8);
+}
+
+
 void print_public_key(const KeyData& key)
 {
-    auto pubkey = base64_encode(key.public_key, sizeof(key.public_key));
+    auto pubkey = Base64Encode(key.public_key, sizeof(key.public_key));
 
     std::cout
         << "Public key: " << pubkey << std::endl
+        << "Key ID:     " << key_id(key) << std::endl
         << std::endl;
     std::cout
         << "Add the public key to the resource file like this:" << std::endl
@@ -163,7 +426,7 @@ void generate_key(const std::string& private_key_file)
     {
         throw std::runtime_error("Failed to open file for writing");
     }
-    file << base64_encode(seed, sizeof(seed));
+    file << Base64Encode(seed, sizeof(seed));
     file.close();
 
     std::cout << "Private key saved to " << private_key_file << std::endl;
@@ -171,31 +434,59 @@ void generate_key(const std::string& private_key_file)
 }
 
 
-void sign_update(const KeyData& key, const std::string& filename)
+void sign_chunk_manifest(const KeyData& key, const std::string& filename)
 {
-    std::ifstream file(filename, std::ios::binary | std::ios::ate);
-    if (!file)
+    auto message = chunk_manifest_signed_message(filename);
+
+    uint8_t signature[64];
+    ed25519_sign(signature, message.data(), message.size(), key.public_key, key.private_key);
+
+    auto sig_base64 = Base64Encode(signature, sizeof(signature));
+
+    if (g_verbose)
     {
-        throw std::runtime_error("Failed to open file for reading");
+        std::cout << "sparkle:chunkManifestEdSignature=\"" << sig_base64 << "\"" << std::endl;
+    }
+    else
+    {
+        std::cout << sig_base64 << std::endl;
     }
+}
 
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
 
-    std::vector<uint8_t> buffer(static_cast<size_t>(size));
-    if (!file.read(reinterpret_cast<char*>(buffer.data()), size))
+void sign_update_tree(const KeyData& key, const std::string& filename)
+{
+    auto message = tree_signed_message(filename);
+
+    uint8_t signature[64];
+    ed25519_sign(signature, message.data(), message.size(), key.public_key, key.private_key);
+
+    auto sig_base64 = Base64Encode(signature, sizeof(signature));
+
+    if (g_verbose)
     {
-        throw std::runtime_error("Failed to read file");
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        std::cout << "sparkle:edSignatureTree=\"" << sig_base64 << "\" sparkle:edKeyId=\"" << key_id(key)
+                  << "\" length=\"" << file.tellg() << "\"" << std::endl;
     }
+    else
+    {
+        std::cout << sig_base64 << std::endl;
+    }
+}
 
+
+void sign_update(const KeyData& key, const std::string& filename)
+{
     uint8_t signature[64];
-    ed25519_sign(signature, buffer.data(), buffer.size(), key.public_key, key.private_key);
+    const uint64_t size = ed25519_sign_file(signature, key, filename);
 
-    auto sig_base64 = base64_encode(signature, sizeof(signature));
+    auto sig_base64 = Base64Encode(signature, sizeof(signature));
 
     if (g_verbose)
     {
-        std::cout << "sparkle:edSignature=\"" << sig_base64 << "\" length=\"" << size << "\"" << std::endl;
+        std::cout << "sparkle:edSignature=\"" << sig_base64 << "\" sparkle:edKeyId=\"" << key_id(key)
+                  << "\" length=\"" << size << "\"" << std::endl;
     }
     else
     {
@@ -206,34 +497,35 @@ void sign_update(const KeyData& key, const std::string& filename)
 
 bool verify_signature(const std::string& pubkey_base64, const std::string& signature_base64, const std::string& filename)
 {
-    auto pubkey = base64_decode(pubkey_base64);
+    auto pubkey = Base64Decode(pubkey_base64);
     if (pubkey.size() != 32)
     {
         throw std::runtime_error("Invalid public key");
     }
 
-    auto signature = base64_decode(signature_base64);
+    auto signature = Base64Decode(signature_base64);
     if (signature.size() != 64)
     {
         throw std::runtime_error("Invalid signature");
     }
 
-    std::ifstream file(filename, std::ios::binary | std::ios::ate);
-    if (!file)
+    if (g_tree || g_chunk_manifest)
     {
-        throw std::runtime_error("Failed to open file");
-    }
+        auto message = g_tree ? tree_signed_message(filename) : chunk_manifest_signed_message(filename);
 
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
-
-    std::vector<uint8_t> buffer(static_cast<size_t>(size));
-    if (!file.read(reinterpret_cast<char*>(buffer.data()), size))
-    {
-        throw std::runtime_error("Failed to read file");
+        if (ed25519_verify(as_bytes(signature), message.data(), message.size(), as_bytes(pubkey)))
+        {
+            std::cout << "Valid signature." << std::endl;
+            return true;
+        }
+        else
+        {
+            std::cout << "Failed: signature is invalid." << std::endl;
+            return false;
+        }
     }
 
-    if (ed25519_verify(signature.data(), buffer.data(), buffer.size(), pubkey.data()))
+    if (ed25519_verify_file(as_bytes(signature), as_bytes(pubkey), filename))
     {
         std::cout << "Valid signature." << std::endl;
         return true;
@@ -246,12 +538,324 @@ bool verify_signature(const std::string& pubkey_base64, const std::string& signa
 }
 
 
+// Options of the generate-appcast command
+struct AppcastOptions
+{
+    std::string directory;
+    std::string url_prefix;
+    std::string title;
+    std::string os;
+    std::string output_file;
+    std::string cache_file;
+};
+
+// Signed release file, i.e. an item of the generated appcast
+struct ReleaseFile
+{
+    std::string name;
+    std::filesystem::path path;
+    std::string version;
+    std::string os;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    std::string digest;     // hex-encoded SHA-512 of the file
+    std::string signature;  // base64-encoded EdDSA signature
+};
+
+const char* const RELEASE_EXTENSIONS[] = { ".exe", ".msi", ".msix" };
+
+const char* const CACHE_HEADER = "winsparkle-tool signatures 1";
+
+
+// Extracts version from file names like MyApp-1.5.2-x64.exe
+std::string version_from_filename(const std::string& name)
+{
+    static const std::regex re("[0-9]+(\\.[0-9]+)+");
+    std::smatch m;
+    if (!std::regex_search(name, m, re))
+        return std::string();
+    return m.str();
+}
+
+// Guesses the sparkle:os value from architecture mentioned in the name
+std::string os_from_filename(std::string name)
+{
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+
+    if (name.find("arm64") != std::string::npos)
+        return "windows-arm64";
+    if (name.find("x64") != std::string::npos ||
+        name.find("x86_64") != std::string::npos ||
+        name.find("amd64") != std::string::npos ||
+        name.find("win64") != std::string::npos)
+        return "windows-x64";
+    if (name.find("x86") != std::string::npos ||
+        name.find("win32") != std::string::npos)
+        return "windows-x86";
+    return "windows";
+}
+
+// Compares dotted numeric versions, returns negative, 0 or positive number
+int compare_versions(const std::string& a, const std::string& b)
+{
+    std::istringstream sa(a), sb(b);
+    while (sa || sb)
+    {
+        unsigned long long na = 0, nb = 0;
+        char dot;
+        if (sa >> na)
+            sa >> dot;
+        if (sb >> nb)
+            sb >> dot;
+        if (na != nb)
+            return na < nb ? -1 : 1;
+    }
+    return 0;
+}
+
+std::string xml_escape(const std::string& s)
+{
+    std::string out;
+    for (char c : s)
+    {
+        switch (c)
+        {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '"': out += "&quot;"; break;
+            default:  out += c;
+        }
+    }
+    return out;
+}
+
+std::string url_escape(const std::string& s)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    std::string out;
+    for (char c : s)
+    {
+        const unsigned char u = static_cast<unsigned char>(c);
+        if (std::isalnum(u) || c == '-' || c == '_' || c == '.' || c == '~')
+        {
+            out += c;
+        }
+        else
+        {
+            out += '%';
+            out += digits[u >> 4];
+            out += digits[u & 0x0F];
+        }
+    }
+    return out;
+}
+
+
+// Signatures from previous runs, by file name. The cache is only valid for
+// the key that was used to create it.
+std::map<std::string, ReleaseFile> load_signature_cache(const std::string& cache_file, const KeyData& key)
+{
+    std::map<std::string, ReleaseFile> cache;
+
+    std::ifstream file(cache_file);
+    std::string line;
+    if (!file || !std::getline(file, line) || line != CACHE_HEADER)
+        return cache;
+    if (!std::getline(file, line) || line != "key " + key_id(key))
+        return cache;
+
+    while (std::getline(file, line))
+    {
+        std::istringstream in(line);
+        ReleaseFile f;
+        if (!(in >> f.size >> f.mtime >> f.digest >> f.signature))
+            continue;
+        in >> std::ws;
+        if (!std::getline(in, f.name) || f.name.empty())
+            continue;
+        cache[f.name] = f;
+    }
+
+    return cache;
+}
+
+void save_signature_cache(const std::string& cache_file, const KeyData& key, const std::vector<ReleaseFile>& files)
+{
+    std::ofstream file(cache_file);
+    if (!file)
+    {
+        throw std::runtime_error("Failed to write signatures cache " + cache_file);
+    }
+
+    file << CACHE_HEADER << "\n"
+         << "key " << key_id(key) << "\n";
+    for (auto& f : files)
+        file << f.size << " " << f.mtime << " " << f.digest << " " << f.signature << " " << f.name << "\n";
+}
+
+
+// Signs the file, unless the cache has its signature. Files whose time
+// changed, but size didn't, are hashed to check whether they were modified,
+// which is cheaper than signing.
+void sign_release_file(ReleaseFile& f, const KeyData& key, const std::map<std::string, ReleaseFile>& cache)
+{
+    auto cached = cache.find(f.name);
+    if (cached != cache.end() && cached->second.size == f.size)
+    {
+        if (cached->second.mtime == f.mtime)
+        {
+            f.digest = cached->second.digest;
+            f.signature = cached->second.signature;
+            return;
+        }
+
+        sha512_context ctx;
+        uint8_t digest[64];
+        sha512_init(&ctx);
+        hash_file(f.path, &ctx);
+        sha512_final(&ctx, digest);
+        if (to_hex(digest, sizeof(digest)) == cached->second.digest)
+        {
+            f.digest = cached->second.digest;
+            f.signature = cached->second.signature;
+            return;
+        }
+    }
+
+    uint8_t signature[64];
+    uint8_t digest[64];
+    f.size = ed25519_sign_file(signature, key, f.path, digest);
+    f.digest = to_hex(digest, sizeof(digest));
+    f.signature = Base64Encode(signature, sizeof(signature));
+}
+
+
+void write_appcast(std::ostream& out, const AppcastOptions& options, const KeyData& key, const std::vector<ReleaseFile>& files)
+{
+    std::string url_prefix = options.url_prefix;
+    if (!url_prefix.empty() && url_prefix.back() != '/')
+        url_prefix += '/';
+
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        << "<rss version=\"2.0\" xmlns:sparkle=\"http://www.andymatuschak.org/xml-namespaces/sparkle\">\n"
+        << "    <channel>\n"
+        << "        <title>" << xml_escape(options.title) << "</title>\n";
+
+    for (auto& f : files)
+    {
+        out << "        <item>\n"
+            << "            <title>Version " << xml_escape(f.version) << "</title>\n"
+            << "            <sparkle:version>" << xml_escape(f.version) << "</sparkle:version>\n"
+            << "            <enclosure url=\"" << xml_escape(url_prefix + url_escape(f.name)) << "\"\n"
+            << "                       sparkle:os=\"" << xml_escape(f.os) << "\"\n"
+            << "                       sparkle:edSignature=\"" << f.signature << "\"\n"
+            << "                       sparkle:edKeyId=\"" << key_id(key) << "\"\n"
+            << "                       length=\"" << f.size << "\"\n"
+            << "                       type=\"application/octet-stream\" />\n"
+            << "        </item>\n";
+    }
+
+    out << "    </channel>\n"
+        << "</rss>\n";
+}
+
+
+void generate_appcast(const KeyData& key, const AppcastOptions& options)
+{
+    namespace fs = std::filesystem;
+
+    std::vector<ReleaseFile> files;
+    for (auto& entry : fs::directory_iterator(options.directory))
+    {
+        if (!entry.is_regular_file())
+            continue;
+
+        std::string ext = entry.path().extension().u8string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+        if (std::find(std::begin(RELEASE_EXTENSIONS), std::end(RELEASE_EXTENSIONS), ext) == std::end(RELEASE_EXTENSIONS))
+            continue;
+
+        ReleaseFile f;
+        f.name = entry.path().filename().u8string();
+        f.path = entry.path();
+        f.version = version_from_filename(f.name);
+        if (f.version.empty())
+        {
+            std::cerr << "Skipping " << f.name << ": no version in file name" << std::endl;
+            continue;
+        }
+        f.os = options.os.empty() ? os_from_filename(f.name) : options.os;
+        f.size = entry.file_size();
+        f.mtime = static_cast<int64_t>(entry.last_write_time().time_since_epoch().count());
+        files.push_back(f);
+    }
+
+    const std::string cache_file = options.cache_file.empty()
+                                   ? (fs::path(options.directory) / "winsparkle-signatures.txt").string()
+                                   : options.cache_file;
+    const auto cache = load_signature_cache(cache_file, key);
+
+    // Sign the files on all cores; each thread takes the next unsigned file.
+    const size_t count = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), files.size());
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        threads.emplace_back([&, i]
+        {
+            try
+            {
+                for (size_t n = next++; n < files.size(); n = next++)
+                    sign_release_file(files[n], key, cache);
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+    for (auto& e : errors)
+    {
+        if (e)
+            std::rethrow_exception(e);
+    }
+
+    save_signature_cache(cache_file, key, files);
+
+    // newest releases first, as customary in appcasts
+    std::sort(files.begin(), files.end(), [](const ReleaseFile& a, const ReleaseFile& b)
+    {
+        const int c = compare_versions(a.version, b.version);
+        return c != 0 ? c > 0 : a.name < b.name;
+    });
+
+    if (options.output_file.empty())
+    {
+        write_appcast(std::cout, options, key, files);
+    }
+    else
+    {
+        std::ofstream out(options.output_file, std::ios::binary);
+        if (!out)
+        {
+            throw std::runtime_error("Failed to open file for writing");
+        }
+        write_appcast(out, options, key, files);
+    }
+}
+
+
 int main(int argc, char* argv[])
 {
     std::string private_key_file;
     std::string filename;
     std::string pubkey;
     std::string signature;
+    AppcastOptions appcast;
 
     argparse::ArgumentParser program("winsparkle-tool", WIN_SPARKLE_VERSION_STRING);
     program.add_description("WinSparkle companion tool");
@@ -286,6 +890,16 @@ int main(int argc, char* argv[])
         .default_value(false)
         .implicit_value(true)
         .store_into(g_verbose);
+    sign_cmd.add_argument("-t", "--tree")
+        .help("sign the file's tree hash, for sparkle:edSignatureTree")
+        .default_value(false)
+        .implicit_value(true)
+        .store_into(g_tree);
+    sign_cmd.add_argument("-m", "--chunk-manifest")
+        .help("sign a chunk manifest, for sparkle:chunkManifestEdSignature")
+        .default_value(false)
+        .implicit_value(true)
+        .store_into(g_chunk_manifest);
     sign_cmd.add_argument("filename")
         .help("file to sign")
         .metavar("FILENAME")
@@ -305,6 +919,16 @@ int main(int argc, char* argv[])
         .metavar("SIGNATURE")
         .required()
         .store_into(signature);
+    verify_cmd.add_argument("-t", "--tree")
+        .help("verify a tree signature (sparkle:edSignatureTree)")
+        .default_value(false)
+        .implicit_value(true)
+        .store_into(g_tree);
+    verify_cmd.add_argument("-m", "--chunk-manifest")
+        .help("verify a chunk manifest's signature (sparkle:chunkManifestEdSignature)")
+        .default_value(false)
+        .implicit_value(true)
+        .store_into(g_chunk_manifest);
     verify_cmd.add_argument("filename")
         .help("file to verify")
         .metavar("FILENAME")
@@ -312,6 +936,42 @@ int main(int argc, char* argv[])
         .store_into(filename);
     program.add_subparser(verify_cmd);
 
+    argparse::ArgumentParser appcast_cmd("generate-appcast", "", argparse::default_arguments::help);
+    appcast_cmd.add_description("sign all installers in a directory and generate appcast for them");
+    appcast_cmd.add_argument("-f", "--private-key-file")
+        .help("file with the private key")
+        .metavar("KEYFILE")
+        .required()
+        .store_into(private_key_file);
+    appcast_cmd.add_argument("-u", "--url-prefix")
+        .help("URL of the directory the installers are published in")
+        .metavar("URL")
+        .required()
+        .store_into(appcast.url_prefix);
+    appcast_cmd.add_argument("-o", "--output")
+        .help("file to save the appcast to (default: standard output)")
+        .metavar("FILENAME")
+        .store_into(appcast.output_file);
+    appcast_cmd.add_argument("--title")
+        .help("title of the appcast")
+        .metavar("TITLE")
+        .default_value(std::string("Updates"))
+        .store_into(appcast.title);
+    appcast_cmd.add_argument("--os")
+        .help("sparkle:os value of all installers (default: guessed from file names)")
+        .metavar("OS")
+        .store_into(appcast.os);
+    appcast_cmd.add_argument("--cache")
+        .help("file with signatures from previous runs (default: winsparkle-signatures.txt in the directory)")
+        .metavar("FILENAME")
+        .store_into(appcast.cache_file);
+    appcast_cmd.add_argument("directory")
+        .help("directory with the installers")
+        .metavar("DIRECTORY")
+        .required()
+        .store_into(appcast.directory);
+    program.add_subparser(appcast_cmd);
+
     try
     {
         program.parse_args(argc, argv);
@@ -340,13 +1000,26 @@ int main(int argc, char* argv[])
         }
         else if (program.is_subcommand_used(sign_cmd))
         {
-            sign_update(load_private_key(private_key_file), filename);
+            if (g_tree && g_chunk_manifest)
+                throw std::runtime_error("--tree and --chunk-manifest can't be used together");
+            if (g_tree)
+                sign_update_tree(load_private_key(private_key_file), filename);
+            else if (g_chunk_manifest)
+                sign_chunk_manifest(load_private_key(private_key_file), filename);
+            else
+                sign_update(load_private_key(private_key_file), filename);
         }
         else if (program.is_subcommand_used(verify_cmd))
         {
+            if (g_tree && g_chunk_manifest)
+                throw std::runtime_error("--tree and --chunk-manifest can't be used together");
             if (!verify_signature(pubkey, signature, filename))
                 return 1;
         }
+        else if (program.is_subcommand_used(appcast_cmd))
+        {
+            generate_appcast(load_private_key(private_key_file), appcast);
+        }
     }
     catch (const std::exception& e)
     {